@@ -0,0 +1,140 @@
+// Batch allocation and batch free against the single pointer path.
+// Each round allocates N blocks of the same size then frees them in
+// allocation order, in reverse order or in a random order, in a heap
+// fragmented by a set of live blocks.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "memory.h"
+
+#define BATCH_BENCH_ROUNDS    20000
+#define BATCH_BENCH_HEAP_SIZE (16 * 1024 * 1024)
+#define BATCH_BENCH_LIVE      4096
+#define BATCH_BENCH_MAX_COUNT 128
+
+struct BatchResult {
+  double Alloc;
+  double Free;
+};
+
+enum FreeOrder {
+  ORDER_ALLOC,
+  ORDER_REVERSE,
+  ORDER_RANDOM
+};
+
+static const char * OrderNames[] = {"alloc", "reverse", "random"};
+
+// Free order of the blocks of a round
+static void MakeOrder(unsigned * Order, unsigned long Count, FreeOrder Kind)
+{
+  for(unsigned long Index = 0; Index < Count; Index++)
+    Order[Index] = (Kind == ORDER_REVERSE) ? Count - 1 - Index : Index;
+  if(Kind != ORDER_RANDOM)
+    return;
+  for(unsigned long Index = Count - 1; Index > 0; Index--)
+  {
+    unsigned long Other = rand() % (Index + 1);
+    unsigned Tmp = Order[Index];
+    Order[Index] = Order[Other];
+    Order[Other] = Tmp;
+  }
+}
+
+static BatchResult MeasureSingle(unsigned long Size, unsigned long Count, FreeOrder Kind)
+{
+  void * Ptrs[BATCH_BENCH_MAX_COUNT];
+  unsigned Order[BATCH_BENCH_MAX_COUNT];
+  unsigned long long AllocCycles = 0;
+  unsigned long long FreeCycles = 0;
+
+  srand(2);
+  for(unsigned Round = 0; Round < BATCH_BENCH_ROUNDS; Round++)
+  {
+    MakeOrder(Order, Count, Kind);
+
+    unsigned long long Start = BenchCycles();
+    for(unsigned long Index = 0; Index < Count; Index++)
+      Ptrs[Index] = memory_alloc(Size);
+    AllocCycles += BenchCycles() - Start;
+
+    Start = BenchCycles();
+    for(unsigned long Index = 0; Index < Count; Index++)
+      memory_free(Ptrs[Order[Index]]);
+    FreeCycles += BenchCycles() - Start;
+  }
+  BatchResult Result = {(double)AllocCycles / (BATCH_BENCH_ROUNDS * Count), (double)FreeCycles / (BATCH_BENCH_ROUNDS * Count)};
+  return Result;
+}
+
+static BatchResult MeasureBatch(unsigned long Size, unsigned long Count, FreeOrder Kind)
+{
+  void * Ptrs[BATCH_BENCH_MAX_COUNT];
+  void * Shuffled[BATCH_BENCH_MAX_COUNT];
+  unsigned Order[BATCH_BENCH_MAX_COUNT];
+  unsigned long long AllocCycles = 0;
+  unsigned long long FreeCycles = 0;
+
+  srand(2);
+  for(unsigned Round = 0; Round < BATCH_BENCH_ROUNDS; Round++)
+  {
+    MakeOrder(Order, Count, Kind);
+
+    unsigned long long Start = BenchCycles();
+    unsigned long Done = memory_alloc_batch(Size, Count, Ptrs);
+    AllocCycles += BenchCycles() - Start;
+
+    for(unsigned long Index = 0; Index < Done; Index++)
+      Shuffled[Index] = Ptrs[Order[Index]];
+
+    Start = BenchCycles();
+    memory_free_batch(Shuffled, Done);
+    FreeCycles += BenchCycles() - Start;
+  }
+  BatchResult Result = {(double)AllocCycles / (BATCH_BENCH_ROUNDS * Count), (double)FreeCycles / (BATCH_BENCH_ROUNDS * Count)};
+  return Result;
+}
+
+int main()
+{
+  static const unsigned long Sizes[] = {16, 256};
+  static const unsigned long Counts[] = {8, 32, 128};
+  std::vector<void *> Live;
+
+  char * address = new char[BATCH_BENCH_HEAP_SIZE];
+  memory_init(address, BATCH_BENCH_HEAP_SIZE);
+
+  // Fragment the heap : keep one block out of two
+  srand(1);
+  for(unsigned Index = 0; Index < 2 * BATCH_BENCH_LIVE; Index++)
+    Live.push_back(memory_alloc(16 + rand() % 512));
+  for(unsigned Index = 0; Index < Live.size(); Index += 2)
+    memory_free(Live[Index]);
+
+  std::cout << std::left << std::setw(24) << "cycles/block" << std::right
+            << std::setw(14) << "single alloc" << std::setw(14) << "batch alloc"
+            << std::setw(14) << "single free" << std::setw(14) << "batch free" << std::endl;
+  for(unsigned SizeIndex = 0; SizeIndex < 2; SizeIndex++)
+  {
+    for(unsigned CountIndex = 0; CountIndex < 3; CountIndex++)
+    {
+      for(unsigned Kind = ORDER_ALLOC; Kind <= ORDER_RANDOM; Kind++)
+      {
+        BatchResult Single = MeasureSingle(Sizes[SizeIndex], Counts[CountIndex], (FreeOrder)Kind);
+        BatchResult Batch = MeasureBatch(Sizes[SizeIndex], Counts[CountIndex], (FreeOrder)Kind);
+        std::cout << std::left << std::setw(4) << Sizes[SizeIndex] << "B x " << std::setw(4) << Counts[CountIndex]
+                  << std::setw(12) << OrderNames[Kind] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(14) << Single.Alloc << std::setw(14) << Batch.Alloc
+                  << std::setw(14) << Single.Free << std::setw(14) << Batch.Free << std::endl;
+      }
+    }
+  }
+
+  for(unsigned Index = 1; Index < Live.size(); Index += 2)
+    memory_free(Live[Index]);
+  delete [] address;
+  return 0;
+}
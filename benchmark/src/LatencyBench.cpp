@@ -0,0 +1,235 @@
+// Latency distribution of memory_alloc and memory_free, with glibc malloc
+// as baseline. Each call is timed alone with the cycle counter, so the
+// numbers include the cost of reading it. The pool sizes and the biggest
+// sizes are the ones of MemInfo in tester/src/MemoryAllocTest.cpp.
+//
+// Usage : LatencyBench [--csv | --json] [--ops count]
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "memory.h"
+
+#define LATENCY_BENCH_OPS     200000
+#define LATENCY_BENCH_SEED    1
+
+struct PoolInformation {
+  unsigned long MemSize;
+  unsigned long MaxAllocSize;
+};
+
+// Same pools as MemInfo of the tester
+static const PoolInformation Pools[4] = {{        8 * 1024,   512 + 1},
+                                         {      128 * 1024,  1024 + 1},
+                                         { 1 * 1024 * 1024, 16384 + 1},
+                                         {16 * 1024 * 1024, 32768 + 1}};
+
+enum Pattern {
+  PATTERN_FIXED,
+  PATTERN_UNIFORM,
+  PATTERN_POWER_LAW,
+  PATTERN_PRODUCER_CONSUMER
+};
+
+static const char * PatternNames[] = {"fixed", "uniform", "power-law", "producer-consumer"};
+
+struct Allocator {
+  const char * Name;
+  void * (*Alloc)(unsigned long size);
+  void (*Free)(void * ptr);
+};
+
+static void * GlibcAlloc(unsigned long size) { return malloc(size); }
+static void GlibcFree(void * ptr) { free(ptr); }
+
+static const Allocator Allocators[2] = {{"fma32", memory_alloc, memory_free},
+                                        {"glibc", GlibcAlloc, GlibcFree}};
+
+struct Latency {
+  unsigned long long Count;
+  unsigned long long Failed;
+  unsigned long long P50;
+  unsigned long long P99;
+  unsigned long long P999;
+  unsigned long long Max;
+};
+
+struct Result {
+  const char * Allocator;
+  const char * Pattern;
+  unsigned long PoolSize;
+  Latency Alloc;
+  Latency Free;
+};
+
+// Size of the next allocation
+static unsigned long NextSize(Pattern Kind, unsigned long MaxAllocSize)
+{
+  switch(Kind)
+  {
+    case PATTERN_FIXED:
+      return 64;
+    case PATTERN_POWER_LAW:
+    {
+      // Pareto distribution (alpha 1.2) from 8 bytes, most sizes are small
+      double u = (rand() + 1.0) / ((double)RAND_MAX + 1.0);
+      double Size = 8.0 / pow(u, 1.0 / 1.2);
+      return (Size < MaxAllocSize) ? (unsigned long)Size : MaxAllocSize - 1;
+    }
+    default:
+      return rand() % MaxAllocSize;
+  }
+}
+
+static Latency Percentiles(std::vector<unsigned long long> & Samples, unsigned long long Failed)
+{
+  Latency Result = {Samples.size(), Failed, 0, 0, 0, 0};
+
+  if(Samples.empty())
+    return Result;
+  std::sort(Samples.begin(), Samples.end());
+  Result.P50 = Samples[Samples.size() / 2];
+  Result.P99 = Samples[(Samples.size() * 99) / 100];
+  Result.P999 = Samples[(Samples.size() * 999) / 1000];
+  Result.Max = Samples.back();
+  return Result;
+}
+
+static Result Measure(const Allocator & Alloc, Pattern Kind, const PoolInformation & Pool, unsigned long Ops)
+{
+  std::vector<unsigned long long> AllocSamples;
+  std::vector<unsigned long long> FreeSamples;
+  unsigned long long Failed = 0;
+
+  // Number of live blocks, about half of the pool for the uniform sizes
+  unsigned long LiveCount = std::max(8UL, Pool.MemSize / (Pool.MaxAllocSize + 32));
+  std::vector<void *> Live(LiveCount, (void *)nullptr);
+  unsigned long Head = 0;
+
+  AllocSamples.reserve(Ops);
+  FreeSamples.reserve(Ops);
+  srand(LATENCY_BENCH_SEED);
+
+  for(unsigned long Op = 0; Op < Ops + LiveCount; Op++)
+  {
+    // The producer/consumer frees the oldest block, the others a random one
+    unsigned long Index = (Kind == PATTERN_PRODUCER_CONSUMER) ? Head : rand() % LiveCount;
+    Head = (Head + 1) % LiveCount;
+    unsigned long Size = NextSize(Kind, Pool.MaxAllocSize);
+    bool Timed = (Op >= LiveCount);
+
+    if(Live[Index] != nullptr)
+    {
+      unsigned long long Start = BenchCycles();
+      Alloc.Free(Live[Index]);
+      unsigned long long Cycles = BenchCycles() - Start;
+      if(Timed)
+        FreeSamples.push_back(Cycles);
+    }
+
+    unsigned long long Start = BenchCycles();
+    Live[Index] = Alloc.Alloc(Size);
+    unsigned long long Cycles = BenchCycles() - Start;
+    if(Timed)
+    {
+      if(Live[Index] == nullptr)
+        Failed++;
+      else
+        AllocSamples.push_back(Cycles);
+    }
+  }
+
+  for(unsigned long Index = 0; Index < LiveCount; Index++)
+  {
+    if(Live[Index] != nullptr)
+      Alloc.Free(Live[Index]);
+  }
+
+  Result Res = {Alloc.Name, PatternNames[Kind], Pool.MemSize, Percentiles(AllocSamples, Failed), Percentiles(FreeSamples, 0)};
+  return Res;
+}
+
+static void PrintCsv(const std::vector<Result> & Results)
+{
+  std::cout << "allocator,pattern,pool_size,op,count,failed,p50,p99,p99.9,max" << std::endl;
+  for(std::vector<Result>::const_iterator iter = Results.begin(); iter != Results.end(); iter++)
+  {
+    const Latency * Ops[2] = {&iter->Alloc, &iter->Free};
+    const char * OpNames[2] = {"alloc", "free"};
+    for(unsigned Op = 0; Op < 2; Op++)
+    {
+      std::cout << iter->Allocator << "," << iter->Pattern << "," << iter->PoolSize << "," << OpNames[Op] << ","
+                << Ops[Op]->Count << "," << Ops[Op]->Failed << "," << Ops[Op]->P50 << "," << Ops[Op]->P99 << ","
+                << Ops[Op]->P999 << "," << Ops[Op]->Max << std::endl;
+    }
+  }
+}
+
+static void PrintJsonLatency(const char * Name, const Latency & Lat)
+{
+  std::cout << "\"" << Name << "\": {\"count\": " << Lat.Count << ", \"failed\": " << Lat.Failed << ", \"p50\": " << Lat.P50
+            << ", \"p99\": " << Lat.P99 << ", \"p99.9\": " << Lat.P999 << ", \"max\": " << Lat.Max << "}";
+}
+
+static void PrintJson(const std::vector<Result> & Results)
+{
+  std::cout << "{\"unit\": \"cycles\", \"results\": [" << std::endl;
+  for(std::vector<Result>::const_iterator iter = Results.begin(); iter != Results.end(); iter++)
+  {
+    std::cout << "  {\"allocator\": \"" << iter->Allocator << "\", \"pattern\": \"" << iter->Pattern
+              << "\", \"pool_size\": " << iter->PoolSize << ", ";
+    PrintJsonLatency("alloc", iter->Alloc);
+    std::cout << ", ";
+    PrintJsonLatency("free", iter->Free);
+    std::cout << "}" << ((iter + 1 != Results.end()) ? "," : "") << std::endl;
+  }
+  std::cout << "]}" << std::endl;
+}
+
+int main(int argc, char * argv[])
+{
+  bool Json = false;
+  unsigned long Ops = LATENCY_BENCH_OPS;
+  std::vector<Result> Results;
+
+  for(int Arg = 1; Arg < argc; Arg++)
+  {
+    if(strcmp(argv[Arg], "--json") == 0)
+      Json = true;
+    else if(strcmp(argv[Arg], "--csv") == 0)
+      Json = false;
+    else if((strcmp(argv[Arg], "--ops") == 0) && (Arg + 1 < argc))
+      Ops = strtoul(argv[++Arg], nullptr, 0);
+    else
+    {
+      std::cerr << "Usage : " << argv[0] << " [--csv | --json] [--ops count]" << std::endl;
+      return 1;
+    }
+  }
+
+  char * address = new char[Pools[3].MemSize];
+  for(unsigned PoolIndex = 0; PoolIndex < 4; PoolIndex++)
+  {
+    for(unsigned Kind = PATTERN_FIXED; Kind <= PATTERN_PRODUCER_CONSUMER; Kind++)
+    {
+      for(unsigned AllocIndex = 0; AllocIndex < 2; AllocIndex++)
+      {
+        // A fresh heap for each run
+        memory_init(address, Pools[PoolIndex].MemSize);
+        Results.push_back(Measure(Allocators[AllocIndex], (Pattern)Kind, Pools[PoolIndex], Ops));
+      }
+    }
+  }
+  delete [] address;
+
+  if(Json)
+    PrintJson(Results);
+  else
+    PrintCsv(Results);
+  return 0;
+}
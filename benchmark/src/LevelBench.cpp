@@ -0,0 +1,185 @@
+// Microbenchmark of the bit scans and of the size to level mapping.
+// The reference functions are the portable loop/cascade bit scans and the
+// division based level computation; the current ones are the functions of
+// the build (make BITWISE=portable to build the portable backend).
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "bitwise.h"
+#include "memory.h"
+
+extern "C" void block_get_levels(unsigned long size, memory_level_t *level);
+
+#define LEVEL_BENCH_LOOP      20
+#define LEVEL_BENCH_INPUTS    (64 * 1024)
+#define LEVEL_BENCH_HEAP_SIZE (1024 * 1024)
+
+__attribute__((noinline)) static unsigned long ref_bit_lowest_pos(unsigned long value)
+{
+  unsigned long pos = 0;
+  while(!(value & 1))
+  {
+    value >>= 1;
+    ++pos;
+  }
+  return pos;
+}
+
+__attribute__((noinline)) static unsigned long ref_bit_highest_pos(unsigned long value)
+{
+  unsigned long res;
+  unsigned long shift;
+
+  res = (value > 0xFFFF) << 4;
+  value >>= res;
+  shift = (value > 0xFF) << 3;
+  value >>= shift;
+  res |= shift;
+  shift = (value > 0xF) << 2;
+  value >>= shift;
+  res |= shift;
+  shift = (value > 0x3) << 1;
+  value >>= shift;
+  res |= shift;
+  res |= (value >> 1);
+  return res;
+}
+
+__attribute__((noinline)) static unsigned long cur_bit_lowest_pos(unsigned long value)
+{
+  return bit_lowest_pos(value);
+}
+
+__attribute__((noinline)) static unsigned long cur_bit_highest_pos(unsigned long value)
+{
+  return bit_highest_pos(value);
+}
+
+// Original division based mapping, with the word size and SLI of the build
+__attribute__((noinline)) static void ref_block_get_levels(unsigned long size, memory_level_t *level)
+{
+  size = RESIZE_DOWN(size, LONG_SIZE_BYTE);
+  if(size < (1UL << MEMORY_FL_SHIFT))
+  {
+    level->fl = 0;
+    level->fl_bitmap = 1;
+    level->sl = size >> MEMORY_ALIGN_LOG2;
+    level->sl_bitmap = 1UL << level->sl;
+  }
+  else
+  {
+    level->fl = ref_bit_highest_pos(size) - (MEMORY_FL_SHIFT - 1);
+    level->fl_bitmap = 1UL << level->fl;
+    level->sl = ((size - (level->fl_bitmap << (MEMORY_FL_SHIFT - 1))) / (level->fl_bitmap >> 1)) >> MEMORY_ALIGN_LOG2;
+    level->sl_bitmap = 1UL << level->sl;
+  }
+}
+
+// Cycles per call of a bit scan over the inputs
+static double MeasureScan(unsigned long (*scan)(unsigned long), const std::vector<unsigned long> & Inputs)
+{
+  unsigned long Sum = 0;
+  unsigned long long Start = BenchCycles();
+  for(unsigned Loop = 0; Loop < LEVEL_BENCH_LOOP; Loop++)
+    for(std::vector<unsigned long>::const_iterator iter = Inputs.begin(); iter != Inputs.end(); iter++)
+      Sum += scan(*iter);
+  unsigned long long Cycles = BenchCycles() - Start;
+  BenchKeep(Sum);
+  return (double)Cycles / (LEVEL_BENCH_LOOP * Inputs.size());
+}
+
+// Cycles per call of a level mapping over the inputs
+static double MeasureLevels(void (*levels)(unsigned long, memory_level_t *), const std::vector<unsigned long> & Inputs)
+{
+  memory_level_t Level;
+  unsigned long Sum = 0;
+  unsigned long long Start = BenchCycles();
+  for(unsigned Loop = 0; Loop < LEVEL_BENCH_LOOP; Loop++)
+  {
+    for(std::vector<unsigned long>::const_iterator iter = Inputs.begin(); iter != Inputs.end(); iter++)
+    {
+      levels(*iter, &Level);
+      Sum += Level.fl + Level.sl;
+    }
+  }
+  unsigned long long Cycles = BenchCycles() - Start;
+  BenchKeep(Sum);
+  return (double)Cycles / (LEVEL_BENCH_LOOP * Inputs.size());
+}
+
+static void Report(const char * Name, double Reference, double Current)
+{
+  std::cout << std::left << std::setw(24) << Name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << Reference << std::setw(12) << Current << std::setw(12) << (Reference - Current) << std::endl;
+}
+
+int main()
+{
+  std::vector<unsigned long> Bitmaps(LEVEL_BENCH_INPUTS);
+  std::vector<unsigned long> SmallSizes(LEVEL_BENCH_INPUTS);
+  std::vector<unsigned long> LargeSizes(LEVEL_BENCH_INPUTS);
+
+  srand(1);
+  for(unsigned Index = 0; Index < LEVEL_BENCH_INPUTS; Index++)
+  {
+    // Bitmaps are never empty when they are scanned, sizes fit in 32 bits
+    Bitmaps[Index] = ((unsigned long)rand() << (rand() % 8)) | (1UL << (rand() % 31));
+    SmallSizes[Index] = rand() % 1024;
+    LargeSizes[Index] = 1024 + rand() % (16 * 1024 * 1024);
+  }
+
+  // The level table is filled by the first heap
+  char * address = new char[LEVEL_BENCH_HEAP_SIZE];
+  memory_init(address, LEVEL_BENCH_HEAP_SIZE);
+
+  // Check both implementations give the same levels
+  for(unsigned Index = 0; Index < LEVEL_BENCH_INPUTS; Index++)
+  {
+    unsigned long Sizes[2] = {SmallSizes[Index], LargeSizes[Index]};
+    for(unsigned i = 0; i < 2; i++)
+    {
+      memory_level_t Reference, Current;
+      ref_block_get_levels(Sizes[i], &Reference);
+      block_get_levels(Sizes[i], &Current);
+      if((Reference.fl != Current.fl) || (Reference.sl != Current.sl))
+      {
+        std::cout << "Level mismatch for size " << Sizes[i] << std::endl;
+        return 1;
+      }
+    }
+  }
+
+#ifdef BITWISE_BUILTIN
+  std::cout << "Bit scan backend : builtin" << std::endl;
+#else
+  std::cout << "Bit scan backend : portable" << std::endl;
+#endif
+  std::cout << std::left << std::setw(24) << "cycles/op" << std::right << std::setw(12) << "reference"
+            << std::setw(12) << "current" << std::setw(12) << "saved" << std::endl;
+  Report("bit_lowest_pos", MeasureScan(ref_bit_lowest_pos, Bitmaps), MeasureScan(cur_bit_lowest_pos, Bitmaps));
+  Report("bit_highest_pos", MeasureScan(ref_bit_highest_pos, Bitmaps), MeasureScan(cur_bit_highest_pos, Bitmaps));
+  Report("levels < 1024 bytes", MeasureLevels(ref_block_get_levels, SmallSizes), MeasureLevels(block_get_levels, SmallSizes));
+  Report("levels >= 1024 bytes", MeasureLevels(ref_block_get_levels, LargeSizes), MeasureLevels(block_get_levels, LargeSizes));
+
+  // Cost of a whole alloc/free pair with the current build
+  std::vector<void *> Blocks;
+  unsigned long long Start = BenchCycles();
+  unsigned long Pairs = 0;
+  for(unsigned Loop = 0; Loop < LEVEL_BENCH_LOOP; Loop++)
+  {
+    for(unsigned Index = 0; Index < LEVEL_BENCH_INPUTS; Index++)
+    {
+      void * ptr = memory_alloc(SmallSizes[Index]);
+      memory_free(ptr);
+      Pairs++;
+    }
+  }
+  std::cout << std::left << std::setw(24) << "alloc/free pair" << std::right << std::setw(12) << "-"
+            << std::setw(12) << (double)(BenchCycles() - Start) / Pairs << std::endl;
+
+  delete [] address;
+  return 0;
+}
@@ -0,0 +1,89 @@
+// Cost of each block operation during a random alloc/free workload, read
+// from the probes of the heap (make clean; make PROBES=1). The cycles of
+// an operation include the operations it calls (a split inserts the tail,
+// a merge extracts its neighbour) and the cost of reading the counter.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include "memory.h"
+
+#define PROBE_BENCH_HEAP_SIZE (16 * 1024 * 1024)
+#define PROBE_BENCH_LOOP      1000000
+#define PROBE_BENCH_LIVE      4096
+
+#if MEMORY_PROBES
+static void Report(const char * Name, const memory_probe_t & Probe)
+{
+  std::cout << std::left << std::setw(16) << Name << std::right << std::setw(12) << Probe.count
+            << std::fixed << std::setprecision(2) << std::setw(14)
+            << (Probe.count ? (double)Probe.cycles / Probe.count : 0.0) << std::endl;
+}
+
+static void Counter(const char * Name, unsigned long Value, unsigned long long Total)
+{
+  std::cout << std::left << std::setw(16) << Name << std::right << std::setw(12) << Value
+            << std::fixed << std::setprecision(2) << std::setw(13) << (Total ? 100.0 * Value / Total : 0.0) << "%" << std::endl;
+}
+#endif /* MEMORY_PROBES */
+
+int main()
+{
+#if !MEMORY_PROBES
+  std::cout << "Probes are not built, run make clean; make PROBES=1" << std::endl;
+  return 0;
+#else
+  std::vector<void *> Live(PROBE_BENCH_LIVE, (void *)nullptr);
+  memory_probes_t Probes;
+
+  char * address = new char[PROBE_BENCH_HEAP_SIZE];
+  memory_init(address, PROBE_BENCH_HEAP_SIZE);
+
+  // Replace a random live block by a new one, mostly small sizes
+  srand(1);
+  memory_reset_probes();
+  for(unsigned long Loop = 0; Loop < PROBE_BENCH_LOOP; Loop++)
+  {
+    unsigned long Index = rand() % PROBE_BENCH_LIVE;
+    unsigned long Size = (rand() & 7) ? 8 + rand() % 256 : 256 + rand() % 8192;
+    if(Live[Index] != nullptr)
+      memory_free(Live[Index]);
+    Live[Index] = memory_alloc(Size);
+  }
+  memory_get_probes(&Probes);
+
+  std::cout << std::left << std::setw(16) << "operation" << std::right << std::setw(12) << "calls"
+            << std::setw(14) << "cycles/call" << std::endl;
+  Report("block_find", Probes.find);
+  Report("block_insert", Probes.insert);
+  Report("block_extract", Probes.extract);
+  Report("block_split", Probes.split);
+  Report("block_merge_left", Probes.merge_left);
+  Report("block_merge_right", Probes.merge_right);
+
+  std::cout << std::endl << std::left << std::setw(16) << "event" << std::right << std::setw(12) << "count"
+            << std::setw(14) << "ratio" << std::endl;
+  Counter("find escalated", Probes.find_escalated, Probes.find.count);
+  Counter("find failed", Probes.find_failed, Probes.find.count);
+  Counter("split refused", Probes.split_refused, Probes.split.count);
+  unsigned long long Frees = Probes.coalesce_none + Probes.coalesce_left + Probes.coalesce_right + Probes.coalesce_both;
+  Counter("no coalescing", Probes.coalesce_none, Frees);
+  Counter("coalesce left", Probes.coalesce_left, Frees);
+  Counter("coalesce right", Probes.coalesce_right, Frees);
+  Counter("coalesce both", Probes.coalesce_both, Frees);
+#if MEMORY_GOOD_FIT
+  Counter("good fit found", Probes.fit_found, Probes.fit_found + Probes.fit_missed);
+  Counter("good fit missed", Probes.fit_missed, Probes.fit_found + Probes.fit_missed);
+  Counter("good fit scanned", Probes.fit_scanned, Probes.fit_found + Probes.fit_missed);
+#endif /* MEMORY_GOOD_FIT */
+
+  for(unsigned long Index = 0; Index < PROBE_BENCH_LIVE; Index++)
+  {
+    if(Live[Index] != nullptr)
+      memory_free(Live[Index]);
+  }
+  delete [] address;
+  return 0;
+#endif /* MEMORY_PROBES */
+}
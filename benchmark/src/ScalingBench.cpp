@@ -0,0 +1,336 @@
+// Throughput of 1 to N threads for three scenarios :
+//  - private  : each thread allocates and frees its own chunks
+//  - prodcons : each thread frees the chunks allocated by its neighbour
+//  - larson   : long lived chunks in a shared array, replaced by any thread
+// FMA32 runs with thread heaps (memory_thread.c) and, when the build has a
+// lock (make LOCK=MEMORY_LOCK_SPIN or LOCK=MEMORY_LOCK_MUTEX), with one
+// shared heap. glibc malloc is the baseline. The peak RSS of each run is the
+// VmHWM of the process, reset before the run when /proc/self/clear_refs allows
+// it; the pools of the thread heaps are kept from one run to the next.
+//
+// Usage : ScalingBench [--threads max] [--ops count]
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+#include "bench.h"
+#include "memory.h"
+#include "memory_thread.h"
+
+#define SCALING_BENCH_THREADS     8
+#define SCALING_BENCH_OPS         200000
+#define SCALING_BENCH_POOL        (8 * 1024 * 1024)
+#define SCALING_BENCH_SLOTS       256
+#define SCALING_BENCH_RING        1024
+#define SCALING_BENCH_MIN_SIZE    16
+#define SCALING_BENCH_MAX_SIZE    512
+
+struct Allocator {
+  const char * Name;
+  void (*ThreadStart)(void);
+  void (*ThreadEnd)(void);
+  void * (*Alloc)(unsigned long size);
+  void (*Free)(void * ptr);
+};
+
+// Pools of the thread heaps, a heap released by a run is adopted by the next one
+static std::mutex PoolMutex;
+static std::vector<char *> Pools;
+
+static void ThreadHeapStart(void)
+{
+  if(memory_thread_init(nullptr, 0) == 0)
+  {
+    char * Pool = new char[SCALING_BENCH_POOL];
+    std::lock_guard<std::mutex> Guard(PoolMutex);
+    Pools.push_back(Pool);
+    memory_thread_init(Pool, SCALING_BENCH_POOL);
+  }
+}
+
+static void ThreadHeapEnd(void) { memory_thread_release(); }
+
+static void NoThreadHook(void) {}
+
+static void * GlibcAlloc(unsigned long size) { return malloc(size); }
+static void GlibcFree(void * ptr) { free(ptr); }
+
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+static memory_management_area_t * SharedHeap;
+
+static void * SharedAlloc(unsigned long size) { return memory_heap_alloc(SharedHeap, size); }
+static void SharedFree(void * ptr) { memory_heap_free(SharedHeap, ptr); }
+#endif /* MEMORY_LOCK */
+
+static const Allocator Allocators[] = {
+  {"fma32-thread", ThreadHeapStart, ThreadHeapEnd, memory_thread_alloc, memory_thread_free},
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+  {"fma32-shared", NoThreadHook, NoThreadHook, SharedAlloc, SharedFree},
+#endif /* MEMORY_LOCK */
+  {"glibc", NoThreadHook, NoThreadHook, GlibcAlloc, GlibcFree}};
+
+enum Scenario {
+  SCENARIO_PRIVATE,
+  SCENARIO_PRODUCER_CONSUMER,
+  SCENARIO_LARSON
+};
+
+static const char * ScenarioNames[] = {"private", "prodcons", "larson"};
+
+// Single producer single consumer ring between two threads
+struct Ring {
+  std::atomic<unsigned long> Head;
+  std::atomic<unsigned long> Tail;
+  void * Slots[SCALING_BENCH_RING];
+};
+
+struct Run {
+  const Allocator * Alloc;
+  unsigned ThreadCount;
+  unsigned long Ops;
+  std::atomic<unsigned> Ready;
+  std::atomic<bool> Go;
+  std::atomic<unsigned long> Failed;
+  std::vector<Ring> Rings;
+  std::vector<std::atomic<void *> > Shared;
+
+  Run(const Allocator * alloc, unsigned threadCount, unsigned long ops)
+    : Alloc(alloc), ThreadCount(threadCount), Ops(ops), Ready(0), Go(false), Failed(0),
+      Rings(threadCount), Shared(threadCount * SCALING_BENCH_SLOTS)
+  {
+    for(unsigned Index = 0; Index < threadCount; Index++)
+    {
+      Rings[Index].Head = 0;
+      Rings[Index].Tail = 0;
+    }
+    for(unsigned long Index = 0; Index < Shared.size(); Index++)
+      Shared[Index] = nullptr;
+  }
+};
+
+// Size and slot generator of a thread
+static inline unsigned long XorShift(unsigned long & State)
+{
+  State ^= State << 13;
+  State ^= State >> 7;
+  State ^= State << 17;
+  return State;
+}
+
+static inline unsigned long NextSize(unsigned long & State)
+{
+  return SCALING_BENCH_MIN_SIZE + XorShift(State) % (SCALING_BENCH_MAX_SIZE - SCALING_BENCH_MIN_SIZE);
+}
+
+static void PrivateChurn(Run & R, unsigned long & State)
+{
+  void * Slots[SCALING_BENCH_SLOTS] = {nullptr};
+
+  for(unsigned long Op = 0; Op < R.Ops; Op++)
+  {
+    void *& Slot = Slots[XorShift(State) % SCALING_BENCH_SLOTS];
+    if(Slot != nullptr)
+      R.Alloc->Free(Slot);
+    Slot = R.Alloc->Alloc(NextSize(State));
+    if(Slot == nullptr)
+      R.Failed++;
+  }
+  for(unsigned Index = 0; Index < SCALING_BENCH_SLOTS; Index++)
+  {
+    if(Slots[Index] != nullptr)
+      R.Alloc->Free(Slots[Index]);
+  }
+}
+
+static void ProducerConsumer(Run & R, unsigned Id, unsigned long & State)
+{
+  // Produce in the own ring, consume the ring of the previous thread
+  Ring & Out = R.Rings[Id];
+  Ring & In = R.Rings[(Id + R.ThreadCount - 1) % R.ThreadCount];
+  unsigned long Produced = 0;
+  unsigned long Consumed = 0;
+
+  while((Produced < R.Ops) || (Consumed < R.Ops))
+  {
+    bool Progress = false;
+    unsigned long Head = Out.Head.load(std::memory_order_relaxed);
+
+    if((Produced < R.Ops) && (Head - Out.Tail.load(std::memory_order_acquire) < SCALING_BENCH_RING))
+    {
+      void * Ptr = R.Alloc->Alloc(NextSize(State));
+      if(Ptr == nullptr)
+        R.Failed++;
+      Out.Slots[Head % SCALING_BENCH_RING] = Ptr;
+      Out.Head.store(Head + 1, std::memory_order_release);
+      Produced++;
+      Progress = true;
+    }
+
+    unsigned long Tail = In.Tail.load(std::memory_order_relaxed);
+    if((Consumed < R.Ops) && (Tail != In.Head.load(std::memory_order_acquire)))
+    {
+      void * Ptr = In.Slots[Tail % SCALING_BENCH_RING];
+      In.Tail.store(Tail + 1, std::memory_order_release);
+      if(Ptr != nullptr)
+        R.Alloc->Free(Ptr);
+      Consumed++;
+      Progress = true;
+    }
+
+    if(!Progress)
+      sched_yield();
+  }
+}
+
+static void Larson(Run & R, unsigned long & State)
+{
+  for(unsigned long Op = 0; Op < R.Ops; Op++)
+  {
+    void * Ptr = R.Alloc->Alloc(NextSize(State));
+    if(Ptr == nullptr)
+      R.Failed++;
+    void * Old = R.Shared[XorShift(State) % R.Shared.size()].exchange(Ptr);
+    if(Old != nullptr)
+      R.Alloc->Free(Old);
+  }
+}
+
+static void Worker(Run & R, Scenario Kind, unsigned Id)
+{
+  unsigned long State = 0x9E3779B97F4A7C15UL ^ (Id + 1);
+
+  R.Alloc->ThreadStart();
+  R.Ready++;
+  while(!R.Go.load(std::memory_order_acquire))
+    sched_yield();
+
+  switch(Kind)
+  {
+    case SCENARIO_PRIVATE:
+      PrivateChurn(R, State);
+      break;
+    case SCENARIO_PRODUCER_CONSUMER:
+      ProducerConsumer(R, Id, State);
+      break;
+    default:
+      Larson(R, State);
+      break;
+  }
+  R.Alloc->ThreadEnd();
+}
+
+// Reset the peak RSS of the process, return false if the kernel does not allow it
+static bool ResetPeakRss(void)
+{
+  std::ofstream ClearRefs("/proc/self/clear_refs");
+  ClearRefs << "5";
+  return ClearRefs.good();
+}
+
+// Peak RSS of the process in KiB
+static unsigned long GetPeakRss(void)
+{
+  std::ifstream Status("/proc/self/status");
+  std::string Line;
+
+  while(std::getline(Status, Line))
+  {
+    if(Line.compare(0, 6, "VmHWM:") == 0)
+      return strtoul(Line.c_str() + 6, nullptr, 10);
+  }
+  return 0;
+}
+
+int main(int argc, char * argv[])
+{
+  unsigned MaxThreads = SCALING_BENCH_THREADS;
+  unsigned long Ops = SCALING_BENCH_OPS;
+
+  for(int Arg = 1; Arg < argc; Arg++)
+  {
+    if((strcmp(argv[Arg], "--threads") == 0) && (Arg + 1 < argc))
+      MaxThreads = strtoul(argv[++Arg], nullptr, 0);
+    else if((strcmp(argv[Arg], "--ops") == 0) && (Arg + 1 < argc))
+      Ops = strtoul(argv[++Arg], nullptr, 0);
+    else
+      MaxThreads = 0;
+  }
+  if((MaxThreads == 0) || (MaxThreads > MEMORY_THREAD_HEAP_MAX))
+  {
+    std::cerr << "Usage : " << argv[0] << " [--threads max (1 to " << MEMORY_THREAD_HEAP_MAX << ")] [--ops count]" << std::endl;
+    return 1;
+  }
+
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+  char * SharedPool = new char[SCALING_BENCH_POOL * MaxThreads];
+#endif /* MEMORY_LOCK */
+
+  // 1, 2, 4 ... threads up to the maximum
+  std::vector<unsigned> ThreadCounts;
+  for(unsigned ThreadCount = 1; ThreadCount < MaxThreads; ThreadCount *= 2)
+    ThreadCounts.push_back(ThreadCount);
+  ThreadCounts.push_back(MaxThreads);
+
+  bool PeakReset = ResetPeakRss();
+  std::cout << "Operations per thread : " << Ops << ", hardware threads : " << std::thread::hardware_concurrency() << std::endl;
+  if(!PeakReset)
+    std::cout << "Peak RSS can not be reset, it is the peak of the process" << std::endl;
+  std::cout << std::left << std::setw(10) << "scenario" << std::setw(14) << "allocator" << std::right << std::setw(8) << "threads"
+            << std::setw(16) << "ops/s" << std::setw(16) << "peak RSS (KiB)" << std::setw(10) << "failed" << std::endl;
+
+  for(unsigned Kind = SCENARIO_PRIVATE; Kind <= SCENARIO_LARSON; Kind++)
+  {
+    for(unsigned AllocIndex = 0; AllocIndex < sizeof(Allocators) / sizeof(Allocators[0]); AllocIndex++)
+    {
+      for(std::vector<unsigned>::iterator Count = ThreadCounts.begin(); Count != ThreadCounts.end(); Count++)
+      {
+        unsigned ThreadCount = *Count;
+        Run R(&Allocators[AllocIndex], ThreadCount, Ops);
+        std::vector<std::thread> Threads;
+
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+        SharedHeap = memory_heap_init(SharedPool, SCALING_BENCH_POOL * MaxThreads);
+#endif /* MEMORY_LOCK */
+        ResetPeakRss();
+
+        for(unsigned Id = 0; Id < ThreadCount; Id++)
+          Threads.push_back(std::thread(Worker, std::ref(R), (Scenario)Kind, Id));
+        while(R.Ready.load() != ThreadCount)
+          sched_yield();
+
+        unsigned long long Start = BenchNanoseconds();
+        R.Go.store(true, std::memory_order_release);
+        for(unsigned Id = 0; Id < ThreadCount; Id++)
+          Threads[Id].join();
+        unsigned long long Elapsed = BenchNanoseconds() - Start;
+
+        // The larson chunks still alive are freed out of the measure, each operation is an allocation and a free
+        for(unsigned long Index = 0; Index < R.Shared.size(); Index++)
+        {
+          if(R.Shared[Index].load() != nullptr)
+            R.Alloc->Free(R.Shared[Index].load());
+        }
+
+        double OpsPerSecond = (2.0 * Ops * ThreadCount) * 1e9 / (Elapsed ? Elapsed : 1);
+        std::cout << std::left << std::setw(10) << ScenarioNames[Kind] << std::setw(14) << Allocators[AllocIndex].Name << std::right
+                  << std::setw(8) << ThreadCount << std::setw(16) << std::fixed << std::setprecision(0) << OpsPerSecond
+                  << std::setw(16) << GetPeakRss() << std::setw(10) << R.Failed.load() << std::endl;
+      }
+    }
+  }
+
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+  delete [] SharedPool;
+#endif /* MEMORY_LOCK */
+  for(std::vector<char *>::iterator iter = Pools.begin(); iter != Pools.end(); iter++)
+    delete [] *iter;
+  return 0;
+}
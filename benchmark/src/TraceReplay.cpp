@@ -0,0 +1,217 @@
+// Replay of a trace recorded by a MEMORY_TRACE build (memory_trace_start).
+// The trace drives a fresh FMA32 heap, or glibc malloc with --malloc, and
+// the replay gives the throughput, the peak footprint and the fragmentation
+// of the heap at regular steps of the trace. The handle lookup is in the
+// measured time, it is the same for both allocators. --fit-scan sets the
+// number of blocks scanned by the good fit of a MEMORY_GOOD_FIT build, 0 for
+// the next level search, to compare their footprint and throughput.
+//
+// Usage : TraceReplay trace_file [--pool bytes] [--malloc] [--steps count] [--fit-scan count]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <malloc.h>
+#include "bench.h"
+#include "memory.h"
+
+extern "C" memory_management_area_t * mma;
+
+#define TRACE_REPLAY_POOL     (16 * 1024 * 1024)
+#define TRACE_REPLAY_STEPS    20
+
+struct FreeSpace {
+  unsigned long FreeBytes;
+  unsigned long LargestBlock;
+};
+
+// Free bytes and biggest free block of the default heap, from its free lists
+static FreeSpace GetFreeSpace(void)
+{
+  FreeSpace Space = {0, 0};
+
+  for(unsigned long fl = 0; fl < mma->fl_count; fl++)
+  {
+    for(unsigned long sl = 0; sl < MEMORY_SL_COUNT; sl++)
+    {
+      for(memory_link_t link = MEMORY_FBLA(mma)[fl][sl]; link != BLOCK_NO_LINK; link = BLOCK_FROM_LINK(mma, link)->next)
+      {
+        memory_block_t * block = BLOCK_FROM_LINK(mma, link);
+        Space.FreeBytes += BLOCK_GET_MASKED_SIZE(block);
+        if(BLOCK_GET_MASKED_SIZE(block) > Space.LargestBlock)
+          Space.LargestBlock = BLOCK_GET_MASKED_SIZE(block);
+      }
+    }
+  }
+  return Space;
+}
+
+static bool ReadTrace(const char * Path, std::vector<memory_trace_record_t> & Records)
+{
+  memory_trace_record_t Buffer[1024];
+  unsigned long Count;
+  FILE * File = fopen(Path, "rb");
+
+  if(File == nullptr)
+    return false;
+  while((Count = fread(Buffer, sizeof(memory_trace_record_t), 1024, File)) > 0)
+    Records.insert(Records.end(), Buffer, Buffer + Count);
+  fclose(File);
+  return true;
+}
+
+int main(int argc, char * argv[])
+{
+  const char * Path = nullptr;
+  unsigned long PoolSize = TRACE_REPLAY_POOL;
+  unsigned long Steps = TRACE_REPLAY_STEPS;
+  unsigned long FitScan = MEMORY_GOOD_FIT_SCAN;
+  bool Malloc = false;
+  bool Usage = false;
+  std::vector<memory_trace_record_t> Records;
+
+  for(int Arg = 1; Arg < argc; Arg++)
+  {
+    if((strcmp(argv[Arg], "--pool") == 0) && (Arg + 1 < argc))
+      PoolSize = strtoul(argv[++Arg], nullptr, 0);
+    else if((strcmp(argv[Arg], "--steps") == 0) && (Arg + 1 < argc))
+      Steps = strtoul(argv[++Arg], nullptr, 0);
+    else if((strcmp(argv[Arg], "--fit-scan") == 0) && (Arg + 1 < argc))
+      FitScan = strtoul(argv[++Arg], nullptr, 0);
+    else if(strcmp(argv[Arg], "--malloc") == 0)
+      Malloc = true;
+    else if((argv[Arg][0] != '-') && (Path == nullptr))
+      Path = argv[Arg];
+    else
+      Usage = true;
+  }
+  if(Usage || (Path == nullptr) || (Steps == 0))
+  {
+    std::cerr << "Usage : " << argv[0] << " trace_file [--pool bytes] [--malloc] [--steps count] [--fit-scan count]" << std::endl;
+    return 1;
+  }
+  if(!ReadTrace(Path, Records))
+  {
+    std::cerr << "Can not read " << Path << std::endl;
+    return 1;
+  }
+
+  // No pool for malloc, it would be in the glibc footprint
+  char * address = Malloc ? nullptr : new char[PoolSize];
+  if(!Malloc && (memory_init(address, PoolSize) == 0))
+  {
+    std::cerr << "Pool of " << PoolSize << " bytes too small" << std::endl;
+    return 1;
+  }
+  if(!Malloc)
+    memory_set_fit_scan(FitScan);
+
+  std::unordered_map<unsigned int, void *> Live;
+  unsigned long TracedFailures = 0;
+  unsigned long Failures = 0;
+  unsigned long LiveBytes = 0;
+  unsigned long PeakLiveBytes = 0;
+  unsigned long PeakFootprint = 0;
+  unsigned long long Nanoseconds = 0;
+  unsigned long StepSize = (Records.size() + Steps - 1) / Steps;
+
+  std::cout << "Replay of " << Records.size() << " records with " << (Malloc ? "glibc malloc" : "FMA32") << std::endl;
+  std::cout << std::setw(12) << "record" << std::setw(14) << "live bytes" << std::setw(14) << "free bytes"
+            << std::setw(14) << "largest free" << std::setw(16) << "fragmentation" << std::endl;
+
+  for(unsigned long Start = 0; Start < Records.size(); Start += StepSize)
+  {
+    unsigned long End = (Start + StepSize < Records.size()) ? Start + StepSize : Records.size();
+    unsigned long long Begin = BenchNanoseconds();
+
+    for(unsigned long Index = Start; Index < End; Index++)
+    {
+      const memory_trace_record_t & Record = Records[Index];
+
+      if(Record.op == MEMORY_TRACE_ALLOC)
+      {
+        void * Ptr = Malloc ? malloc(Record.size) : memory_alloc(Record.size);
+
+        if(Record.handle == MEMORY_TRACE_NO_HANDLE)
+        {
+          // Failed when it was recorded, nothing frees it later
+          TracedFailures++;
+          if(Malloc)
+            free(Ptr);
+          else
+            memory_free(Ptr);
+        }
+        else if(Ptr == nullptr)
+        {
+          Failures++;
+        }
+        else
+        {
+          unsigned long Size = Malloc ? malloc_usable_size(Ptr) : memory_usable_size(Ptr);
+          Live[Record.handle] = Ptr;
+          LiveBytes += Size;
+          if(LiveBytes > PeakLiveBytes)
+            PeakLiveBytes = LiveBytes;
+          if(!Malloc && ((unsigned long)((char *)Ptr + Size - address) > PeakFootprint))
+            PeakFootprint = (char *)Ptr + Size - address;
+        }
+      }
+      else
+      {
+        std::unordered_map<unsigned int, void *>::iterator iter = Live.find(Record.handle);
+
+        // The allocation failed in the replay
+        if(iter == Live.end())
+          continue;
+        LiveBytes -= Malloc ? malloc_usable_size(iter->second) : memory_usable_size(iter->second);
+        if(Malloc)
+          free(iter->second);
+        else
+          memory_free(iter->second);
+        Live.erase(iter);
+      }
+    }
+    Nanoseconds += BenchNanoseconds() - Begin;
+
+    std::cout << std::setw(12) << End << std::setw(14) << LiveBytes;
+    if(Malloc)
+    {
+      std::cout << std::setw(14) << "-" << std::setw(14) << "-" << std::setw(16) << "-" << std::endl;
+    }
+    else
+    {
+      FreeSpace Space = GetFreeSpace();
+      double Fragmentation = (Space.FreeBytes > 0) ? 100.0 * (1.0 - (double)Space.LargestBlock / Space.FreeBytes) : 0.0;
+      std::cout << std::setw(14) << Space.FreeBytes << std::setw(14) << Space.LargestBlock << std::setw(15)
+                << std::fixed << std::setprecision(1) << Fragmentation << "%" << std::endl;
+    }
+  }
+
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+  if(Malloc)
+  {
+    struct mallinfo2 Info = mallinfo2();
+    PeakFootprint = Info.arena + Info.hblkhd;
+  }
+#endif /* __GLIBC__ */
+
+  std::cout << "Operations       : " << Records.size() << " in " << Nanoseconds / 1000 << " us ("
+            << std::fixed << std::setprecision(0) << (Nanoseconds ? Records.size() * 1e9 / Nanoseconds : 0.0) << " ops/s)" << std::endl;
+  std::cout << "Peak live bytes  : " << PeakLiveBytes << std::endl;
+  std::cout << "Peak footprint   : " << PeakFootprint << (Malloc ? " (glibc arena at the end, the records of the replay included)" : " (end of the highest chunk in the pool)") << std::endl;
+  std::cout << "Failed           : " << Failures << " (" << TracedFailures << " failed when recorded)" << std::endl;
+
+  for(std::unordered_map<unsigned int, void *>::iterator iter = Live.begin(); iter != Live.end(); iter++)
+  {
+    if(Malloc)
+      free(iter->second);
+    else
+      memory_free(iter->second);
+  }
+  delete [] address;
+  return 0;
+}
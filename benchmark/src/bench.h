@@ -0,0 +1,35 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Cycle counter, nanoseconds when the CPU has no cycle counter
+static inline unsigned long long BenchCycles(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// Monotonic time in nanoseconds
+static inline unsigned long long BenchNanoseconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Keep a result alive so the compiler does not remove the measured code
+static inline void BenchKeep(unsigned long value)
+{
+  __asm__ __volatile__("" : : "r"(value) : "memory");
+}
+
+#endif // BENCH_H
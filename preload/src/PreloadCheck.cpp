@@ -0,0 +1,225 @@
+// Check of the preloaded allocator : LD_PRELOAD=bin/libfma32.so bin/PreloadCheck
+// The memory of the C library functions, of new and of the threads must be
+// in the FMA32 heap, and a child forked while the threads allocate must be
+// able to allocate. A copy of the check run with small pools fills them from
+// several threads at once, only the pools needed must be added.
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define PRELOAD_THREADS         4
+#define PRELOAD_FORKS           20
+#define PRELOAD_GROW_POOL       (16UL << 20)
+#define PRELOAD_GROW_CHUNK      (PRELOAD_GROW_POOL / 5 * 2)
+
+typedef unsigned long (*OwnsFunction)(void * ptr);
+
+static OwnsFunction Owns;
+
+static bool Check(bool Condition, const char * What)
+{
+  if(!Condition)
+    std::cout << "FAILED : " << What << std::endl;
+  return Condition;
+}
+
+static void Churn(std::atomic<bool> * Stop, std::atomic<bool> * Failed)
+{
+  std::vector<void *> Blocks(256, nullptr);
+  unsigned int Seed = 1;
+
+  while(!Stop->load())
+  {
+    unsigned long Index = rand_r(&Seed) % Blocks.size();
+    free(Blocks[Index]);
+    Blocks[Index] = malloc(1 + rand_r(&Seed) % 2048);
+    if((Blocks[Index] == nullptr) || !Owns(Blocks[Index]))
+      Failed->store(true);
+  }
+  for(void * Ptr : Blocks)
+    free(Ptr);
+}
+
+// Virtual size of the process in KiB, read without allocating
+static unsigned long VirtualSize(void)
+{
+  char Text[4096];
+  int File = open("/proc/self/status", O_RDONLY);
+  if(File < 0)
+    return 0;
+  ssize_t Length = read(File, Text, sizeof(Text) - 1);
+  close(File);
+  if(Length <= 0)
+    return 0;
+  Text[Length] = 0;
+  const char * Line = strstr(Text, "VmSize:");
+  return (Line != nullptr) ? strtoul(Line + 7, nullptr, 10) : 0;
+}
+
+// Threads failing together on full pools add the pools they need, not one
+// each. A pool holds two chunks of PRELOAD_GROW_CHUNK bytes, the first pool
+// is filled before the threads allocate one chunk each at the same time. The
+// pools are mmap areas, their number is given by the growth of the virtual size
+static int GrowCheck(void)
+{
+  std::atomic<bool> Start(false);
+  std::atomic<bool> Release(false);
+  std::atomic<unsigned long> Finished(0);
+  std::atomic<bool> Failed(false);
+  std::vector<std::thread> Threads;
+
+  for(unsigned long Index = 0; Index < 2 * PRELOAD_THREADS; Index++)
+  {
+    Threads.push_back(std::thread([&]()
+    {
+      while(!Start.load())
+        sched_yield();
+      void * Chunk = malloc(PRELOAD_GROW_CHUNK);
+      if(Chunk == nullptr)
+        Failed.store(true);
+      Finished++;
+      while(!Release.load())
+        sched_yield();
+      free(Chunk);
+    }));
+  }
+
+  void * First = malloc(PRELOAD_GROW_CHUNK);
+  void * Second = malloc(PRELOAD_GROW_CHUNK);
+  unsigned long Before = VirtualSize();
+  Start.store(true);
+  while(Finished.load() < Threads.size())
+    sched_yield();
+  unsigned long Pools = (VirtualSize() - Before) / (PRELOAD_GROW_POOL >> 10);
+  Release.store(true);
+  for(std::thread & Thread : Threads)
+    Thread.join();
+  free(First);
+  free(Second);
+
+  bool Pass = Check((First != nullptr) && (Second != nullptr) && !Failed.load(), "allocations of the threads filling the pools");
+  Pass &= Check(Pools == Threads.size() / 2, "pools added by the threads filling the pools");
+  if(!Pass)
+    std::cout << Pools << " pools added for " << Threads.size() << " chunks" << std::endl;
+  return Pass ? 0 : 1;
+}
+
+int main(int argc, char ** argv)
+{
+  bool Pass = true;
+
+  if((argc > 1) && (strcmp(argv[1], "grow") == 0))
+    return GrowCheck();
+
+  Owns = (OwnsFunction)dlsym(RTLD_DEFAULT, "memory_owns");
+  if(Owns == nullptr)
+  {
+    std::cout << "FAILED : libfma32.so is not preloaded" << std::endl;
+    return 1;
+  }
+
+  // C library functions
+  void * Ptr = malloc(100);
+  Pass &= Check((Ptr != nullptr) && Owns(Ptr) && (((unsigned long)Ptr & (alignof(max_align_t) - 1)) == 0), "malloc");
+  Pass &= Check(malloc_usable_size(Ptr) >= 100, "malloc_usable_size");
+  void * Sized[1024];
+  bool IsAligned = true;
+  for(unsigned long Size = 0; Size < 1024; Size++)
+  {
+    Sized[Size] = malloc(Size);
+    IsAligned &= (Sized[Size] != nullptr) && (((unsigned long)Sized[Size] & (MEMORY_CHUNK_ALIGN - 1)) == 0);
+  }
+  for(unsigned long Size = 0; Size < 1024; Size++)
+    free(Sized[Size]);
+  Pass &= Check(IsAligned, "malloc alignment of the small sizes");
+  memset(Ptr, 0x5A, 100);
+  Ptr = realloc(Ptr, 100000);
+  Pass &= Check((Ptr != nullptr) && Owns(Ptr) && (((unsigned char *)Ptr)[99] == 0x5A), "realloc");
+  free(Ptr);
+  unsigned char * Zero = (unsigned char *)calloc(1000, 8);
+  bool IsZero = (Zero != nullptr);
+  for(unsigned long Index = 0; IsZero && (Index < 8000); Index++)
+    IsZero = (Zero[Index] == 0);
+  Pass &= Check(IsZero && Owns(Zero), "calloc");
+  free(Zero);
+  volatile size_t Count = (size_t)-1 / 8;
+  Pass &= Check((calloc(Count, 16) == nullptr) && (errno == ENOMEM), "calloc overflow");
+
+  // Sizes no pool can hold are refused like the C library does
+  const size_t Sizes[] = {SIZE_MAX, SIZE_MAX - 40, (size_t)PTRDIFF_MAX + 1, SIZE_MAX / 2};
+  void * volatile Kept = malloc(100);
+  for(size_t Size : Sizes)
+  {
+    volatile size_t Huge = Size;
+    void * Out = nullptr;
+    errno = 0;
+    Pass &= Check((malloc(Huge) == nullptr) && (errno == ENOMEM), "malloc of a huge size");
+    Pass &= Check((calloc(1, Huge) == nullptr) && (errno == ENOMEM), "calloc of a huge size");
+    Pass &= Check((realloc(Kept, Huge) == nullptr) && (errno == ENOMEM), "realloc of a huge size");
+    Pass &= Check((memalign(64, Huge) == nullptr) && (aligned_alloc(64, Huge & ~(size_t)63) == nullptr), "aligned allocation of a huge size");
+    Pass &= Check(posix_memalign(&Out, 4096, Huge) == ENOMEM, "posix_memalign of a huge size");
+  }
+  Pass &= Check(Owns(Kept) && (malloc_usable_size(Kept) >= 100), "memory kept by a refused realloc");
+  free(Kept);
+  Pass &= Check((posix_memalign(&Ptr, 4096, 5000) == 0) && Owns(Ptr) && (((unsigned long)Ptr & 4095) == 0), "posix_memalign");
+  free(Ptr);
+  Ptr = aligned_alloc(64, 640);
+  Pass &= Check((Ptr != nullptr) && Owns(Ptr) && (((unsigned long)Ptr & 63) == 0), "aligned_alloc");
+  free(Ptr);
+  std::string * Text = new std::string(1000, 'x');
+  Pass &= Check(Owns(Text) && Owns((void *)Text->data()), "operator new");
+  delete Text;
+  struct alignas(128) Aligned { char Bytes[128]; };
+  Aligned * Array = new Aligned[10];
+  Pass &= Check(Owns(Array) && (((unsigned long)Array & 127) == 0), "aligned operator new");
+  delete [] Array;
+
+  // Threads and forks while the threads allocate
+  std::atomic<bool> Stop(false);
+  std::atomic<bool> Failed(false);
+  std::vector<std::thread> Threads;
+  for(unsigned long Index = 0; Index < PRELOAD_THREADS; Index++)
+    Threads.push_back(std::thread(Churn, &Stop, &Failed));
+  bool ForkPass = true;
+  for(unsigned long Index = 0; Index < PRELOAD_FORKS; Index++)
+  {
+    pid_t Child = fork();
+    if(Child == 0)
+    {
+      void * ChildPtr = malloc(1000);
+      _exit(((ChildPtr != nullptr) && Owns(ChildPtr)) ? 0 : 1);
+    }
+    int Status = 1;
+    ForkPass = ForkPass && (Child > 0) && (waitpid(Child, &Status, 0) == Child) && WIFEXITED(Status) && (WEXITSTATUS(Status) == 0);
+  }
+  Stop.store(true);
+  for(std::thread & Thread : Threads)
+    Thread.join();
+  Pass &= Check(!Failed.load(), "threads");
+  Pass &= Check(ForkPass, "fork");
+
+  // Filling of small pools by threads in a copy of the check
+  pid_t Child = fork();
+  if(Child == 0)
+  {
+    setenv("FMA32_POOL", std::to_string(PRELOAD_GROW_POOL).c_str(), 1);
+    execl("/proc/self/exe", argv[0], "grow", (char *)nullptr);
+    _exit(1);
+  }
+  int Status = 1;
+  Pass &= Check((Child > 0) && (waitpid(Child, &Status, 0) == Child) && WIFEXITED(Status) && (WEXITSTATUS(Status) == 0), "pools added by concurrent threads");
+
+  std::cout << (Pass ? "Preload check PASSED" : "Preload check FAILED") << std::endl;
+  return Pass ? 0 : 1;
+}
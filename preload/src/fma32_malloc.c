@@ -0,0 +1,372 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* malloc, free and the other functions of the C library on the default heap,
+   for LD_PRELOAD. The first call reserves the pool with mmap (FMA32_POOL
+   bytes, default FMA32_POOL_DEFAULT), pages are given by the system when
+   they are touched. FMA32_PAGES selects the pages of the pools : 0 normal
+   (default), 1 transparent huge pages, 2 explicit huge pages. When the heap
+   is full an other pool of the same size is added, up to MEMORY_POOL_MAX
+   pools. The heap lock is held across fork so the child gets a consistent
+   heap. A pointer out of the heap (allocated before the library was loaded)
+   is never freed. */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "memory.h"
+#include "memory_os.h"
+
+/* Size of a pool reserved from the system */
+#ifndef FMA32_POOL_DEFAULT
+#if ULONG_MAX > 0xFFFFFFFFUL
+#define FMA32_POOL_DEFAULT                      (1UL << 30)
+#else
+#define FMA32_POOL_DEFAULT                      (256UL << 20)
+#endif /* ULONG_MAX */
+#endif /* FMA32_POOL_DEFAULT */
+
+/* Alignment of malloc, the one of the chunks of the heap. Build memory.c with
+   MEMORY_CHUNK_ALIGN at 16 for the one of max_align_t like the C library */
+#define FMA32_MALLOC_ALIGN                      MEMORY_CHUNK_ALIGN
+
+/* State of the default heap */
+#define HEAP_UNINITIALIZED                      0
+#define HEAP_INITIALIZING                       1
+#define HEAP_READY                              2
+#define HEAP_FAILED                             3
+
+static int heap_state = HEAP_UNINITIALIZED;
+static unsigned long pool_size;
+static unsigned long pool_pages;
+/* Only one thread reserves a new pool */
+static unsigned long grow_lock;
+
+/******************************************************************************
+ * grow_lock_enter
+ * Enter the critical section of the pool reservation
+ *****************************************************************************/
+static void grow_lock_enter(void)
+{
+  while(__atomic_exchange_n(&grow_lock, 1, __ATOMIC_ACQUIRE) != 0)
+  {
+    while(__atomic_load_n(&grow_lock, __ATOMIC_RELAXED))
+      sched_yield();
+  }
+}
+
+/******************************************************************************
+ * grow_lock_leave
+ * Leave the critical section of the pool reservation
+ *****************************************************************************/
+static void grow_lock_leave(void)
+{
+  __atomic_store_n(&grow_lock, 0, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * fork_prepare
+ * Hold the locks of the allocator while the process forks
+ *****************************************************************************/
+static void fork_prepare(void)
+{
+  grow_lock_enter();
+  memory_lock();
+}
+
+/******************************************************************************
+ * fork_release
+ * Release the locks in the parent and in the child after a fork
+ *****************************************************************************/
+static void fork_release(void)
+{
+  memory_unlock();
+  grow_lock_leave();
+}
+
+/******************************************************************************
+ * heap_bootstrap
+ * Reserve the first pool and initialize the default heap. The first caller
+ * does it, the other threads wait. No function of the C library allocating
+ * memory is called before the heap is ready
+ *
+ * Return 1 if the heap is ready, 0 otherwise
+ *****************************************************************************/
+static int heap_bootstrap(void)
+{
+  int expected = HEAP_UNINITIALIZED;
+  const char * env;
+  memory_os_pool_t pool;
+
+  if(!__atomic_compare_exchange_n(&heap_state, &expected, HEAP_INITIALIZING, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+  {
+    while(__atomic_load_n(&heap_state, __ATOMIC_ACQUIRE) == HEAP_INITIALIZING)
+      sched_yield();
+    return (__atomic_load_n(&heap_state, __ATOMIC_ACQUIRE) == HEAP_READY) ? 1 : 0;
+  }
+
+  env = getenv("FMA32_POOL");
+  pool_size = (env != NULL) ? strtoul(env, NULL, 0) : 0;
+  if(pool_size == 0)
+    pool_size = FMA32_POOL_DEFAULT;
+  env = getenv("FMA32_PAGES");
+  pool_pages = (env != NULL) ? strtoul(env, NULL, 0) : MEMORY_OS_PAGES_NORMAL;
+
+  /* The added pools have the length of the first one */
+  if(memory_os_init(&pool, pool_size, pool_pages, 0) == 0)
+  {
+    __atomic_store_n(&heap_state, HEAP_FAILED, __ATOMIC_RELEASE);
+    return 0;
+  }
+  pool_size = pool.length;
+  __atomic_store_n(&heap_state, HEAP_READY, __ATOMIC_RELEASE);
+
+  /* It may allocate, the heap is ready */
+  pthread_atfork(fork_prepare, fork_release, fork_release);
+  return 1;
+}
+
+/******************************************************************************
+ * heap_ready
+ * Check that the default heap is initialized, initialize it the first time
+ *
+ * Return 1 if the heap can be used, 0 otherwise
+ *****************************************************************************/
+static inline int heap_ready(void)
+{
+  if(__atomic_load_n(&heap_state, __ATOMIC_ACQUIRE) == HEAP_READY)
+    return 1;
+  return heap_bootstrap();
+}
+
+/******************************************************************************
+ * heap_try_alloc
+ * Allocate an aligned memory in the pools of the heap
+ *
+ * [in] alignment : alignment of the memory (power of two)
+ * [in] size      : size of the memory
+ *
+ * Return the memory or null if the pools are full
+ *****************************************************************************/
+static inline void * heap_try_alloc(size_t alignment, size_t size)
+{
+  if(alignment <= MEMORY_CHUNK_ALIGN)
+    return memory_alloc(size);
+  return memory_memalign(alignment, size);
+}
+
+/******************************************************************************
+ * heap_grow
+ * Allocate after a failed allocation, adding pools to the heap. The threads
+ * failing together wait for the first one, then try again in the pool it has
+ * added before adding one more
+ *
+ * [in] alignment : alignment of the memory (power of two)
+ * [in] size      : size of the memory
+ *
+ * Return the memory or null if no pool can be added
+ *****************************************************************************/
+static void * heap_grow(size_t alignment, size_t size)
+{
+  memory_os_pool_t pool;
+  void * ptr;
+
+  /* A pool is as big as the first one, the heap has no level for more */
+  if(size + alignment >= pool_size / 2)
+    return NULL;
+
+  grow_lock_enter();
+  ptr = heap_try_alloc(alignment, size);
+  while((ptr == NULL) && memory_os_reserve(&pool, pool_size, pool_pages, 0))
+  {
+    if(!memory_add_pool(pool.address, pool.length))
+    {
+      memory_os_release(&pool);
+      break;
+    }
+    ptr = heap_try_alloc(alignment, size);
+  }
+  grow_lock_leave();
+  return ptr;
+}
+
+/******************************************************************************
+ * heap_fits
+ * Check that a size can be held by a pool, like the C library the sizes over
+ * PTRDIFF_MAX are refused. The heap is ready
+ *
+ * [in] alignment : alignment of the memory (power of two)
+ * [in] size      : size of the memory
+ *
+ * Return 1 if the size fits a pool, 0 otherwise
+ *****************************************************************************/
+static inline int heap_fits(size_t alignment, size_t size)
+{
+  return (size <= PTRDIFF_MAX) && (size < pool_size) && (alignment < pool_size - size);
+}
+
+/******************************************************************************
+ * heap_alloc
+ * Allocate an aligned memory, a pool is added if the heap is full
+ *
+ * [in] alignment : alignment of the memory (power of two)
+ * [in] size      : size of the memory
+ *
+ * Return the memory or null with errno set to ENOMEM
+ *****************************************************************************/
+static void * heap_alloc(size_t alignment, size_t size)
+{
+  void * ptr;
+
+  if(!heap_ready() || !heap_fits(alignment, size))
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  ptr = heap_try_alloc(alignment, size);
+  if(ptr == NULL)
+    ptr = heap_grow(alignment, size);
+
+  if(ptr == NULL)
+    errno = ENOMEM;
+  return ptr;
+}
+
+/******************************************************************************
+ * heap_owns
+ * Check that a pointer is a memory of the heap
+ *
+ * [in] ptr : pointer
+ *
+ * Return 1 if the pointer is in the heap
+ *****************************************************************************/
+static inline int heap_owns(void * ptr)
+{
+  return (ptr != NULL) && (__atomic_load_n(&heap_state, __ATOMIC_ACQUIRE) == HEAP_READY) && memory_owns(ptr);
+}
+
+void * malloc(size_t size)
+{
+  return heap_alloc(FMA32_MALLOC_ALIGN, size);
+}
+
+void free(void * ptr)
+{
+  if(heap_owns(ptr))
+    memory_free(ptr);
+}
+
+void * calloc(size_t count, size_t size)
+{
+  void * ptr;
+
+  if((size != 0) && (count > SIZE_MAX / size))
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+  ptr = heap_alloc(FMA32_MALLOC_ALIGN, count * size);
+  if(ptr != NULL)
+    memset(ptr, 0, count * size);
+  return ptr;
+}
+
+void * realloc(void * ptr, size_t size)
+{
+  void * new_ptr;
+  size_t copy_size;
+
+  if(ptr == NULL)
+    return malloc(size);
+  if(size == 0)
+  {
+    free(ptr);
+    return NULL;
+  }
+  if(!heap_owns(ptr) || !heap_fits(FMA32_MALLOC_ALIGN, size))
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  /* In place when the next block is free, the alignment is kept */
+  if(memory_try_expand(ptr, size))
+    return ptr;
+
+  new_ptr = heap_alloc(FMA32_MALLOC_ALIGN, size);
+  if(new_ptr == NULL)
+    return NULL;
+  copy_size = memory_usable_size(ptr);
+  memcpy(new_ptr, ptr, (copy_size < size) ? copy_size : size);
+  memory_free(ptr);
+  return new_ptr;
+}
+
+void * reallocarray(void * ptr, size_t count, size_t size)
+{
+  if((size != 0) && (count > SIZE_MAX / size))
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+  return realloc(ptr, count * size);
+}
+
+int posix_memalign(void ** out, size_t alignment, size_t size)
+{
+  void * ptr;
+
+  if((alignment < sizeof(void *)) || (alignment & (alignment - 1)))
+    return EINVAL;
+  ptr = heap_alloc((alignment > FMA32_MALLOC_ALIGN) ? alignment : FMA32_MALLOC_ALIGN, size);
+  if(ptr == NULL)
+    return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+
+void * aligned_alloc(size_t alignment, size_t size)
+{
+  if((alignment == 0) || (alignment & (alignment - 1)))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+  return heap_alloc((alignment > FMA32_MALLOC_ALIGN) ? alignment : FMA32_MALLOC_ALIGN, size);
+}
+
+void * memalign(size_t alignment, size_t size)
+{
+  return aligned_alloc(alignment, size);
+}
+
+void * valloc(size_t size)
+{
+  return heap_alloc(sysconf(_SC_PAGESIZE), size);
+}
+
+size_t malloc_usable_size(void * ptr)
+{
+  return heap_owns(ptr) ? memory_usable_size(ptr) : 0;
+}
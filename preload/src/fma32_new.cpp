@@ -0,0 +1,83 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Global operator new and delete on the malloc functions of fma32_malloc.c.
+// A failed allocation calls the new handler and tries again, without handler
+// it throws std::bad_alloc (null for the nothrow versions).
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+void * Allocate(std::size_t size, std::size_t alignment)
+{
+  while(true)
+  {
+    void * ptr = nullptr;
+    if(alignment <= alignof(std::max_align_t))
+      ptr = malloc(size);
+    else if(posix_memalign(&ptr, alignment, size) != 0)
+      ptr = nullptr;
+    if(ptr != nullptr)
+      return ptr;
+
+    std::new_handler handler = std::get_new_handler();
+    if(handler == nullptr)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void * AllocateNoThrow(std::size_t size, std::size_t alignment) noexcept
+{
+  try
+  {
+    return Allocate(size, alignment);
+  }
+  catch(...)
+  {
+    return nullptr;
+  }
+}
+
+} // namespace
+
+void * operator new(std::size_t size) {return Allocate(size, 0);}
+void * operator new[](std::size_t size) {return Allocate(size, 0);}
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept {return AllocateNoThrow(size, 0);}
+void * operator new[](std::size_t size, const std::nothrow_t &) noexcept {return AllocateNoThrow(size, 0);}
+void * operator new(std::size_t size, std::align_val_t alignment) {return Allocate(size, (std::size_t)alignment);}
+void * operator new[](std::size_t size, std::align_val_t alignment) {return Allocate(size, (std::size_t)alignment);}
+void * operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {return AllocateNoThrow(size, (std::size_t)alignment);}
+void * operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {return AllocateNoThrow(size, (std::size_t)alignment);}
+
+// A block knows its size and its alignment, all the versions free it the same way
+void operator delete(void * ptr) noexcept {free(ptr);}
+void operator delete[](void * ptr) noexcept {free(ptr);}
+void operator delete(void * ptr, const std::nothrow_t &) noexcept {free(ptr);}
+void operator delete[](void * ptr, const std::nothrow_t &) noexcept {free(ptr);}
+void operator delete(void * ptr, std::size_t) noexcept {free(ptr);}
+void operator delete[](void * ptr, std::size_t) noexcept {free(ptr);}
+void operator delete(void * ptr, std::align_val_t) noexcept {free(ptr);}
+void operator delete[](void * ptr, std::align_val_t) noexcept {free(ptr);}
+void operator delete(void * ptr, std::align_val_t, const std::nothrow_t &) noexcept {free(ptr);}
+void operator delete[](void * ptr, std::align_val_t, const std::nothrow_t &) noexcept {free(ptr);}
+void operator delete(void * ptr, std::size_t, std::align_val_t) noexcept {free(ptr);}
+void operator delete[](void * ptr, std::size_t, std::align_val_t) noexcept {free(ptr);}
@@ -19,42 +19,54 @@
 #ifndef BITWISE_H
 #define BITWISE_H
 
-#define BIT(pos)			(1 << (pos))    /* Define a bit */
+#define BIT(pos)			(1UL << (pos))  /* Define a bit */
+#ifndef CHAR_BIT
 #define CHAR_BIT      8               /* 8 bits per byte */
+#endif /* CHAR_BIT */
 
-inline unsigned long bit_set(register unsigned long value, register unsigned long pos)
+/* Bit scan backend : compiler builtins when available, else portable code.
+   Define BITWISE_PORTABLE to force the portable code */
+#if !defined(BITWISE_PORTABLE) && (defined(__GNUC__) || defined(__clang__))
+#define BITWISE_BUILTIN
+#endif
+
+static inline unsigned long bit_set(unsigned long value, unsigned long pos)
 {
   return (value |= BIT(pos));
 }
 
-inline unsigned long bit_clear(register unsigned long value, register unsigned long pos)
+static inline unsigned long bit_clear(unsigned long value, unsigned long pos)
 {
   return (value &= ~BIT(pos));
 }
 
-inline unsigned long bit_toggle(register unsigned long value, register unsigned long pos)
+static inline unsigned long bit_toggle(unsigned long value, unsigned long pos)
 {
   return (value ^= BIT(pos));
 }
 
-inline unsigned long bit_check(register unsigned long value, register unsigned long pos)
+static inline unsigned long bit_check(unsigned long value, unsigned long pos)
 {
   return (value & BIT(pos) ? 1 : 0);
 }
 
-inline unsigned long bit_mask(register unsigned long pos)
+static inline unsigned long bit_mask(unsigned long pos)
 {
   return (BIT(pos) - 1);
 }
 
-inline unsigned long is_power_of_two(unsigned long value)
+static inline unsigned long is_power_of_two(unsigned long value)
 {
   return ((value != 0) && !(value & (value - 1)));
 }
 
 
-inline unsigned long bit_lowest_pos(register unsigned long value)
+/* value must not be 0 */
+static inline unsigned long bit_lowest_pos(unsigned long value)
 {
+#ifdef BITWISE_BUILTIN
+  return __builtin_ctzl(value);
+#else
   unsigned long pos = 0;
   while(!(value & 1))
   {
@@ -62,15 +74,27 @@ inline unsigned long bit_lowest_pos(register unsigned long value)
     ++pos;
   }
   return pos;
+#endif /* BITWISE_BUILTIN */
 }
 
-inline unsigned long bit_highest_pos(register unsigned long value)
+/* value must not be 0 */
+static inline unsigned long bit_highest_pos(unsigned long value)
 {
-  register unsigned long res;
-  register unsigned long shift;
+#ifdef BITWISE_BUILTIN
+  return (sizeof(value) * CHAR_BIT - 1) - __builtin_clzl(value);
+#else
+  unsigned long res = 0;
+  unsigned long shift;
 
-  res = (value > 0xFFFF) << 4;
-  value >>= res;
+  if(sizeof(value) > 4)
+  {
+    /* Upper 32 bits of a 64 bits value, in two shifts to stay valid for 32 bits */
+    res = ((value >> 16 >> 16) != 0) << 5;
+    value = value >> (res >> 1) >> (res >> 1);
+  }
+  shift = (value > 0xFFFF) << 4;
+  value >>= shift;
+  res |= shift;
   shift = (value > 0xFF) << 3;
   value >>= shift;
   res |= shift;
@@ -82,24 +106,25 @@ inline unsigned long bit_highest_pos(register unsigned long value)
   res |= shift;
   res |= (value >> 1);
   return res;
+#endif /* BITWISE_BUILTIN */
 }
 
-inline unsigned long bit_highest(register unsigned long value)
+static inline unsigned long bit_highest(unsigned long value)
 {
-  return (1 << bit_highest_pos(value));
+  return (BIT(bit_highest_pos(value)));
 }
 
-inline unsigned long bitfield_mask(register unsigned long start, register unsigned long length)
+static inline unsigned long bitfield_mask(unsigned long start, unsigned long length)
 {
   return (bit_mask(length) << (start));
 }
 
-inline unsigned long bitfield_extract(register unsigned long value, register unsigned long start, register unsigned long length)
+static inline unsigned long bitfield_extract(unsigned long value, unsigned long start, unsigned long length)
 {
   return ((value >> start) & bit_mask(length));
 }
 
-inline unsigned long bit_next_power_of_two(register unsigned long value)
+static inline unsigned long bit_next_power_of_two(unsigned long value)
 {
   if(!(value & (value - 1)))
     return (value);
@@ -109,12 +134,12 @@ inline unsigned long bit_next_power_of_two(register unsigned long value)
   return value;
 }
 
-inline unsigned long bit_rotate_left(unsigned long value, unsigned long shift)
+static inline unsigned long bit_rotate_left(unsigned long value, unsigned long shift)
 {
   return (value << shift) | (value >> (sizeof(value) * CHAR_BIT - shift));
 }
 
-inline unsigned long bit_rotate_right(unsigned long value, unsigned long shift)
+static inline unsigned long bit_rotate_right(unsigned long value, unsigned long shift)
 {
   return (value >> shift) | (value << (sizeof(value) * CHAR_BIT - shift));
 }
@@ -0,0 +1,186 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/* Header only C++ handle of the memory.c heaps, with the level of a constant
+   size computed by the compiler and given to memory_heap_alloc_level. It is
+   not a template on a configuration : every operation is the one of memory.c
+   (deferred coalescing, good fit, address order, compact header and offset
+   links included), so the C and the C++ heaps never differ, and the word
+   size, levels, alignment, minimum block, lock and statistics are the ones of
+   the MEMORY_* macros memory.c is built with. They can not be chosen per heap,
+   two configurations need two builds of memory.c. Link with memory.c. */
+
+#ifndef FMA32_HPP
+#define FMA32_HPP
+
+#include <cstddef>
+#include "memory.h"
+
+namespace fma32 {
+
+namespace detail {
+
+constexpr unsigned Log2(unsigned long value)
+{
+  return (value <= 1) ? 0 : 1 + Log2(value >> 1);
+}
+
+/* value must not be 0 */
+constexpr unsigned HighestBit(unsigned long value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (sizeof(unsigned long) * 8 - 1) - __builtin_clzl(value);
+#else
+  return Log2(value);
+#endif
+}
+
+} // namespace detail
+
+/* Handle of a memory.c heap */
+class Heap
+{
+  public:
+    typedef unsigned long Word;
+
+    /* Settings memory.c is built with */
+    static constexpr int LockPolicy = MEMORY_LOCK;
+    static constexpr bool Statistics = (MEMORY_STATS != 0);
+    static constexpr Word PoolMax = MEMORY_POOL_MAX;
+    static constexpr Word SlCount = MEMORY_SL_COUNT;
+    static constexpr unsigned AlignLog2 = MEMORY_ALIGN_LOG2;
+    static constexpr Word Alignment = (Word)1 << MEMORY_ALIGN_LOG2;
+    /* Sizes under 1 << FlShift are in the first level 0, by step of Alignment */
+    static constexpr unsigned FlShift = MEMORY_FL_SHIFT;
+    static constexpr Word HeaderSize = BLOCK_HEADER_SIZE_USED;
+    static constexpr Word MinBlockSize = BLOCK_MIN_SIZE;
+    /* Alignment of the chunks, a block and its header take a multiple of it */
+    static constexpr Word ChunkAlignment = MEMORY_CHUNK_ALIGN;
+    /* Biggest size whose rounding does not wrap around */
+    static constexpr Word MaxSize = ~(Word)0 - (ChunkAlignment - 1) - HeaderSize;
+
+    /* Size of the block of a chunk, same as BLOCK_ROUND_SIZE */
+    static constexpr Word RoundUp(Word size)
+    {
+      return ((size + HeaderSize + ChunkAlignment - 1) & ~(ChunkAlignment - 1)) - HeaderSize;
+    }
+
+    static constexpr unsigned long GetFl(Word size)
+    {
+      return (size < ((Word)1 << FlShift)) ? 0 : detail::HighestBit(size) - FlShift + 1;
+    }
+
+    static constexpr unsigned long GetSl(Word size)
+    {
+      return (size < ((Word)1 << FlShift)) ? (size >> AlignLog2) : ((size >> (GetFl(size) + AlignLog2 - 1)) & (SlCount - 1));
+    }
+
+    static constexpr memory_level_t MakeLevel(unsigned long fl, unsigned long sl)
+    {
+      return memory_level_t{fl, 1UL << fl, sl, 1UL << sl};
+    }
+
+    /* Levels of a size, same as block_get_levels */
+    static constexpr memory_level_t GetLevel(Word size)
+    {
+      return MakeLevel(GetFl(size), GetSl(size));
+    }
+
+    /* Level where all the blocks are big enough for the size, same as block_get_next_level */
+    static constexpr memory_level_t GetNextLevel(Word size)
+    {
+      return (GetSl(size) == SlCount - 1) ? MakeLevel(GetFl(size) + 1, 0) : MakeLevel(GetFl(size), GetSl(size) + 1);
+    }
+
+    /* Size of the block given for an allocation */
+    static constexpr Word GetAllocSize(Word size)
+    {
+      return (size > MinBlockSize) ? RoundUp(size) : RoundUp(MinBlockSize);
+    }
+
+    /* Level searched for an allocation */
+    static constexpr memory_level_t GetAllocLevel(Word size)
+    {
+      return (size > MinBlockSize) ? GetNextLevel(RoundUp(size)) : GetLevel(RoundUp(MinBlockSize));
+    }
+
+    Heap(void) : m_area(nullptr) {}
+    /* A heap of memory_heap_init */
+    explicit Heap(memory_management_area_t * area) : m_area(area) {}
+
+    /**************************************************************************
+     * Create
+     * Prepare a heap at the start of a memory area, memory_heap_init
+     *
+     * [in] address : memory pointer
+     * [in] length  : size of the memory
+     *
+     * Return the heap, not valid if the memory is too small
+     *************************************************************************/
+    static Heap Create(void * address, Word length)
+    {
+      return Heap(memory_heap_init(address, length));
+    }
+
+    bool IsValid(void) const { return m_area != nullptr; }
+    memory_management_area_t * GetArea(void) const { return m_area; }
+
+    /* Memory allocation, memory_heap_alloc */
+    void * Alloc(Word size)
+    {
+      return memory_heap_alloc(m_area, size);
+    }
+
+    /* Allocation of a size known at compile time, its level is folded */
+    template<Word Size>
+    void * Alloc(void)
+    {
+      static_assert(Size <= MaxSize, "No block is that big");
+      static constexpr memory_level_t level = GetAllocLevel(Size);
+      return memory_heap_alloc_level(m_area, GetAllocSize(Size), &level);
+    }
+
+    void Free(void * ptr) { memory_heap_free(m_area, ptr); }
+    static Word UsableSize(void * ptr) { return memory_usable_size(ptr); }
+
+    bool AddPool(void * address, Word length) { return memory_heap_add_pool(m_area, address, length) != 0; }
+    bool RemovePool(void * address) { return memory_heap_remove_pool(m_area, address) != 0; }
+    bool Owns(void * ptr) const { return memory_heap_owns(m_area, ptr) != 0; }
+
+    memory_stats_t GetStats(void) const
+    {
+      memory_stats_t stats;
+      memory_heap_get_stats(m_area, &stats);
+      return stats;
+    }
+
+    memory_lock_stats_t GetLockStats(void) const
+    {
+      memory_lock_stats_t stats;
+      memory_heap_get_lock_stats(m_area, &stats);
+      return stats;
+    }
+
+  private:
+    memory_management_area_t * m_area;
+};
+
+} // namespace fma32
+
+#endif /* FMA32_HPP */
@@ -19,7 +19,420 @@
 #include "bitwise.h"
 #include "memory.h"
 
-STATIC memory_management_area_t mma;
+#if (MEMORY_LOCK != MEMORY_LOCK_NONE) || MEMORY_PROBES || MEMORY_TRACE
+#include <time.h>
+#endif /* MEMORY_LOCK */
+
+#if MEMORY_TRACE
+#include <stdio.h>
+#endif /* MEMORY_TRACE */
+
+#if MEMORY_LOCK == MEMORY_LOCK_SPIN
+/* Maximum number of pause between two reads of a busy spinlock */
+#ifndef MEMORY_SPIN_BACKOFF_MAX
+#define MEMORY_SPIN_BACKOFF_MAX                 1024
+#endif /* MEMORY_SPIN_BACKOFF_MAX */
+
+#if defined(__i386__) || defined(__x86_64__)
+#define CPU_RELAX()                             __builtin_ia32_pause()
+#else
+#define CPU_RELAX()                             __asm__ __volatile__("" ::: "memory")
+#endif
+#endif /* MEMORY_LOCK */
+
+/* Sizes under this limit get their levels from a table */
+#ifndef LEVEL_TABLE_LIMIT
+#define LEVEL_TABLE_LIMIT                       1024
+#endif /* LEVEL_TABLE_LIMIT */
+
+/* Biggest size which can be rounded up to a block without wrapping around */
+#define SIZE_ROUND_MAX                          (ULONG_MAX - (MEMORY_CHUNK_ALIGN - 1) - BLOCK_HEADER_SIZE_USED)
+
+/* Probes of the block operations, the variable of the start time is local */
+#if MEMORY_PROBES
+#define PROBE_START(name)                       unsigned long long probe_##name = probe_get_cycles()
+#define PROBE_END(mma, name)                    probe_end(&(mma)->probes.name, probe_##name)
+#define PROBE_COUNT(mma, counter)               ((mma)->probes.counter++)
+#else
+#define PROBE_START(name)
+#define PROBE_END(mma, name)
+#define PROBE_COUNT(mma, counter)
+#endif /* MEMORY_PROBES */
+
+/* A parked block is free but out of the free lists, its prev link is BLOCK_PARKED_LINK */
+#if MEMORY_DEFER
+#define BLOCK_IS_PARKED(block)                  ((block)->prev == BLOCK_PARKED_LINK)
+#else
+#define BLOCK_IS_PARKED(block)                  0
+#endif /* MEMORY_DEFER */
+
+/* Heap used by the default API (memory_init, memory_alloc, memory_free) */
+STATIC memory_management_area_t * mma;
+
+/* State of the level table, it is filled once by the first memory_heap_init */
+#define LEVEL_TABLE_EMPTY                       0
+#define LEVEL_TABLE_FILLING                     1
+#define LEVEL_TABLE_READY                       2
+
+/* First and second level of the small sizes, by step of a word */
+STATIC unsigned char level_table[LEVEL_TABLE_LIMIT >> MEMORY_ALIGN_LOG2][2];
+STATIC unsigned long level_table_state;
+
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+/******************************************************************************
+ * lock_get_time
+ * Get a monotonic time to measure the lock wait
+ *
+ * Return the time in nanoseconds
+ *****************************************************************************/
+STATIC unsigned long long lock_get_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif /* MEMORY_LOCK */
+
+#if MEMORY_TRACE
+/* Trace file of the default heap and the records not written yet */
+STATIC FILE * trace_file;
+STATIC memory_trace_record_t trace_buffer[MEMORY_TRACE_BUFFER];
+STATIC unsigned long trace_count;
+STATIC unsigned long long trace_last_time;
+
+/******************************************************************************
+ * trace_get_time
+ * Get a monotonic time for the trace records
+ *
+ * Return the time in nanoseconds
+ *****************************************************************************/
+static inline unsigned long long trace_get_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/******************************************************************************
+ * trace_flush
+ * Write the buffered trace records to the trace file
+ *****************************************************************************/
+STATIC void trace_flush(void)
+{
+  if(trace_count > 0)
+    fwrite(trace_buffer, sizeof(memory_trace_record_t), trace_count, trace_file);
+  trace_count = 0;
+}
+#endif /* MEMORY_TRACE */
+
+#if MEMORY_PROBES
+/******************************************************************************
+ * probe_get_cycles
+ * Get the cycle counter, or a monotonic time without cycle counter
+ *
+ * Return the cycles (or nanoseconds)
+ *****************************************************************************/
+static inline unsigned long long probe_get_cycles(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/******************************************************************************
+ * probe_end
+ * Count a block operation and its cycles
+ *
+ * [in] probe : probe of the operation
+ * [in] start : cycles at the start of the operation
+ *****************************************************************************/
+static inline void probe_end(memory_probe_t * probe, unsigned long long start)
+{
+  probe->count++;
+  probe->cycles += probe_get_cycles() - start;
+}
+#endif /* MEMORY_PROBES */
+
+/******************************************************************************
+ * heap_lock
+ * Enter the critical section of a heap
+ *
+ * [in] mma : heap
+ *****************************************************************************/
+static inline void heap_lock(memory_management_area_t * mma)
+{
+#if MEMORY_LOCK == MEMORY_LOCK_SPIN
+  unsigned long long start;
+  unsigned long backoff;
+  unsigned long pause;
+  unsigned long spin = 0;
+
+  /* Fast path, the lock is free */
+  if(__atomic_exchange_n(&mma->lock, 1, __ATOMIC_ACQUIRE) == 0)
+  {
+    mma->lock_stats.acquire_count++;
+    return;
+  }
+
+  /* Test and test and set with exponential backoff */
+  start = lock_get_time();
+  backoff = 1;
+  do
+  {
+    while(__atomic_load_n(&mma->lock, __ATOMIC_RELAXED))
+    {
+      for(pause = 0; pause < backoff; pause++)
+        CPU_RELAX();
+      spin += backoff;
+      if(backoff < MEMORY_SPIN_BACKOFF_MAX)
+        backoff <<= 1;
+    }
+  } while(__atomic_exchange_n(&mma->lock, 1, __ATOMIC_ACQUIRE) != 0);
+
+  mma->lock_stats.acquire_count++;
+  mma->lock_stats.contended_count++;
+  mma->lock_stats.spin_count += spin;
+  mma->lock_stats.wait_ns += lock_get_time() - start;
+#elif MEMORY_LOCK == MEMORY_LOCK_MUTEX
+  unsigned long long start;
+
+  /* Fast path, the lock is free */
+  if(pthread_mutex_trylock(&mma->lock) == 0)
+  {
+    mma->lock_stats.acquire_count++;
+    return;
+  }
+
+  start = lock_get_time();
+  pthread_mutex_lock(&mma->lock);
+  mma->lock_stats.acquire_count++;
+  mma->lock_stats.contended_count++;
+  mma->lock_stats.wait_ns += lock_get_time() - start;
+#else
+  (void)mma;
+#endif /* MEMORY_LOCK */
+}
+
+/******************************************************************************
+ * heap_unlock
+ * Leave the critical section of a heap
+ *
+ * [in] mma : heap
+ *****************************************************************************/
+static inline void heap_unlock(memory_management_area_t * mma)
+{
+#if MEMORY_LOCK == MEMORY_LOCK_SPIN
+  __atomic_store_n(&mma->lock, 0, __ATOMIC_RELEASE);
+#elif MEMORY_LOCK == MEMORY_LOCK_MUTEX
+  pthread_mutex_unlock(&mma->lock);
+#else
+  (void)mma;
+#endif /* MEMORY_LOCK */
+}
+
+/******************************************************************************
+ * probe_coalesce
+ * Count the merges of a freed block in the probes
+ *
+ * [in] mma   : heap
+ * [in] left  : the block is merged with its left block
+ * [in] right : the block is merged with its right block
+ *****************************************************************************/
+static inline void probe_coalesce(memory_management_area_t * mma, unsigned long left, unsigned long right)
+{
+#if MEMORY_PROBES
+  if(left && right)
+    mma->probes.coalesce_both++;
+  else if(left)
+    mma->probes.coalesce_left++;
+  else if(right)
+    mma->probes.coalesce_right++;
+  else
+    mma->probes.coalesce_none++;
+#else
+  (void)mma;
+  (void)left;
+  (void)right;
+#endif /* MEMORY_PROBES */
+}
+
+/******************************************************************************
+ * stats_alloc
+ * Count an allocated block in the heap statistics
+ *
+ * [in] mma  : heap
+ * [in] size : usable size of the block
+ *****************************************************************************/
+static inline void stats_alloc(memory_management_area_t * mma, unsigned long size)
+{
+#if MEMORY_STATS
+  mma->stats.alloc_count++;
+  mma->stats.used_size += size;
+  if(mma->stats.used_size > mma->stats.peak_size)
+    mma->stats.peak_size = mma->stats.used_size;
+#else
+  (void)mma;
+  (void)size;
+#endif /* MEMORY_STATS */
+}
+
+/******************************************************************************
+ * stats_free
+ * Count a freed block in the heap statistics
+ *
+ * [in] mma  : heap
+ * [in] size : usable size of the block
+ *****************************************************************************/
+static inline void stats_free(memory_management_area_t * mma, unsigned long size)
+{
+#if MEMORY_STATS
+  mma->stats.free_count++;
+  mma->stats.used_size -= size;
+#else
+  (void)mma;
+  (void)size;
+#endif /* MEMORY_STATS */
+}
+
+/******************************************************************************
+ * stats_resize
+ * Count a resized block in the heap statistics
+ *
+ * [in] mma      : heap
+ * [in] old_size : usable size of the block before
+ * [in] new_size : usable size of the block after
+ *****************************************************************************/
+static inline void stats_resize(memory_management_area_t * mma, unsigned long old_size, unsigned long new_size)
+{
+#if MEMORY_STATS
+  mma->stats.used_size += new_size - old_size;
+  if(mma->stats.used_size > mma->stats.peak_size)
+    mma->stats.peak_size = mma->stats.used_size;
+#else
+  (void)mma;
+  (void)old_size;
+  (void)new_size;
+#endif /* MEMORY_STATS */
+}
+
+/******************************************************************************
+ * stats_fail
+ * Count a failed allocation in the heap statistics
+ *
+ * [in] mma : heap
+ *****************************************************************************/
+static inline void stats_fail(memory_management_area_t * mma)
+{
+#if MEMORY_STATS
+  mma->stats.failed_count++;
+#else
+  (void)mma;
+#endif /* MEMORY_STATS */
+}
+
+/******************************************************************************
+ * trace_record
+ * Append a call of the default heap to the trace
+ *
+ * [in] op   : MEMORY_TRACE_ALLOC or MEMORY_TRACE_FREE
+ * [in] ptr  : allocated or freed chunk (null for a failed allocation)
+ * [in] size : wanted size of an allocation
+ *****************************************************************************/
+static inline void trace_record(unsigned int op, void * ptr, unsigned long size)
+{
+#if MEMORY_TRACE
+  memory_trace_record_t * record;
+  unsigned long long now;
+
+  /* Read without the lock to keep the calls without trace fast */
+  if(__atomic_load_n(&trace_file, __ATOMIC_RELAXED) == NULL)
+    return;
+
+  /* The lock of the default heap also orders the records, the trace may
+     have been stopped before it is taken */
+  heap_lock(mma);
+  if(trace_file == NULL)
+  {
+    heap_unlock(mma);
+    return;
+  }
+  now = trace_get_time();
+  record = &trace_buffer[trace_count++];
+  record->op = op;
+  record->handle = (ptr != NULL) ? (unsigned int)(((unsigned long)ptr - (unsigned long)mma) / LONG_SIZE_BYTE) : MEMORY_TRACE_NO_HANDLE;
+  record->size = (size < 0xFFFFFFFFUL) ? (unsigned int)size : 0xFFFFFFFFU;
+  record->time_delta = (now - trace_last_time < 0xFFFFFFFFULL) ? (unsigned int)(now - trace_last_time) : 0xFFFFFFFFU;
+  trace_last_time = now;
+  if(trace_count == MEMORY_TRACE_BUFFER)
+    trace_flush();
+  heap_unlock(mma);
+#else
+  (void)op;
+  (void)ptr;
+  (void)size;
+#endif /* MEMORY_TRACE */
+}
+
+/******************************************************************************
+ * block_compute_levels
+ * Compute the level according to the size
+ *
+ * [in] size    : wanted size
+ * [out] level  : level initialized according to the size
+ *
+ *****************************************************************************/
+static inline void block_compute_levels(unsigned long size, memory_level_t *level)
+{
+  /* Calculate fl and sl values */
+  if(size < (1UL << MEMORY_FL_SHIFT))
+  {
+    level->fl = 0;
+    level->sl = size >> MEMORY_ALIGN_LOG2;
+  }
+  else
+  {
+    /* The second level is given by the MEMORY_SL_LOG2 bits following the highest bit */
+    level->fl = bit_highest_pos(size) - MEMORY_FL_SHIFT + 1;
+    level->sl = (size >> (level->fl + MEMORY_ALIGN_LOG2 - 1)) & (MEMORY_SL_COUNT - 1);
+  }
+  level->fl_bitmap = 1UL << level->fl;
+  level->sl_bitmap = 1UL << level->sl;
+}
+
+/******************************************************************************
+ * level_table_init
+ * Fill the table of the levels of the small sizes. The first caller fills
+ * it, the heaps initialized at the same time by other threads wait for it
+ *****************************************************************************/
+STATIC void level_table_init(void)
+{
+  memory_level_t level;
+  unsigned long index;
+  unsigned long expected = LEVEL_TABLE_EMPTY;
+
+  if(__atomic_load_n(&level_table_state, __ATOMIC_ACQUIRE) == LEVEL_TABLE_READY)
+    return;
+  if(!__atomic_compare_exchange_n(&level_table_state, &expected, LEVEL_TABLE_FILLING, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+  {
+    while(__atomic_load_n(&level_table_state, __ATOMIC_ACQUIRE) != LEVEL_TABLE_READY);
+    return;
+  }
+
+  for(index = 0; index < (LEVEL_TABLE_LIMIT >> MEMORY_ALIGN_LOG2); index++)
+  {
+    block_compute_levels(index << MEMORY_ALIGN_LOG2, &level);
+    level_table[index][0] = (unsigned char)level.fl;
+    level_table[index][1] = (unsigned char)level.sl;
+  }
+  __atomic_store_n(&level_table_state, LEVEL_TABLE_READY, __ATOMIC_RELEASE);
+}
 
 /******************************************************************************
  * block_get_levels
@@ -31,23 +444,17 @@ STATIC memory_management_area_t mma;
  *****************************************************************************/
 STATIC void block_get_levels(unsigned long size, memory_level_t *level)
 {
-  size = RESIZE_DOWN(size, 4);
-
-  /* Calculate fl and sl values */
-  if(size < 128)
+  if(size < LEVEL_TABLE_LIMIT)
   {
-
-    level->fl = 0;
-    level->fl_bitmap = 1;
-    level->sl = size >> 2;
-    level->sl_bitmap = 1 << level->sl;
+    /* Small size, read the levels in the table */
+    level->fl = level_table[size >> MEMORY_ALIGN_LOG2][0];
+    level->sl = level_table[size >> MEMORY_ALIGN_LOG2][1];
+    level->fl_bitmap = 1UL << level->fl;
+    level->sl_bitmap = 1UL << level->sl;
   }
   else
   {
-    level->fl = bit_highest_pos(size) - 6;
-    level->fl_bitmap = 1 << level->fl;
-    level->sl = ((size - ((level->fl_bitmap << 6))) / (level->fl_bitmap >> 1)) >> 2;
-    level->sl_bitmap = 1 << level->sl;
+    block_compute_levels(size, level);
   }
 }
 
@@ -61,10 +468,10 @@ STATIC void block_get_levels(unsigned long size, memory_level_t *level)
 STATIC unsigned long block_get_next_level(unsigned long size, memory_level_t *level)
 {
   block_get_levels(size, level);
-  level->sl_bitmap <<= 1;
-  if(level->sl_bitmap == 0)
+  if(level->sl == (MEMORY_SL_COUNT - 1))
   {
     level->sl = 0;
+    level->sl_bitmap = 1;
     level->fl++;
     level->fl_bitmap <<= 1;
     if(level->fl_bitmap == 0)
@@ -73,159 +480,293 @@ STATIC unsigned long block_get_next_level(unsigned long size, memory_level_t *le
   else
   {
     level->sl++;
+    level->sl_bitmap <<= 1;
   }
   return 1;
 }
 
+/******************************************************************************
+ * block_get_physical_next
+ * Get the next physical block from the current block
+ *
+ * [in] block : current block
+ *****************************************************************************/
+static inline memory_block_t * block_get_physical_next(memory_block_t *block)
+{
+  return (memory_block_t *)((unsigned long) block + BLOCK_GET_MASKED_SIZE(block) + BLOCK_HEADER_SIZE_USED);
+}
+
+/******************************************************************************
+ * block_get_physical_prev
+ * Get the previous physical block of the current block
+ *
+ * [in] mma   : heap
+ * [in] block : current block
+ *
+ * Return null if the block is the first of its pool. With the compact header
+ * only a free previous block is known, null is returned for a used one
+ *****************************************************************************/
+static inline memory_block_t * block_get_physical_prev(memory_management_area_t * mma, memory_block_t *block)
+{
+#if MEMORY_COMPACT_HEADER
+  (void)mma;
+  return BLOCK_IS_PREV_FREE(block) ? ((memory_block_t **)block)[-1] : NULL;
+#else
+  return (block->phys_prev == BLOCK_NO_LINK) ? NULL : BLOCK_FROM_LINK(mma, block->phys_prev);
+#endif /* MEMORY_COMPACT_HEADER */
+}
+
+/******************************************************************************
+ * block_set_physical_prev
+ * Set the previous physical block of a block. The compact header has no
+ * pointer, the link is made when the previous block goes to the free lists
+ *
+ * [in] mma   : heap
+ * [in] block : current block
+ * [in] prev  : previous physical block (null for the first block of a pool)
+ *****************************************************************************/
+static inline void block_set_physical_prev(memory_management_area_t * mma, memory_block_t *block, memory_block_t *prev)
+{
+#if MEMORY_COMPACT_HEADER
+  (void)mma;
+  (void)block;
+  (void)prev;
+#else
+  block->phys_prev = (prev == NULL) ? BLOCK_NO_LINK : BLOCK_TO_LINK(mma, prev);
+#endif /* MEMORY_COMPACT_HEADER */
+}
+
+/******************************************************************************
+ * block_link_free
+ * Compact header : write the address of a free block in its last word and
+ * tell the next physical block that its previous block is free
+ *
+ * [in] block : free block (its size and last flag are set)
+ *****************************************************************************/
+static inline void block_link_free(memory_block_t *block)
+{
+#if MEMORY_COMPACT_HEADER
+  memory_block_t * next_block = block_get_physical_next(block);
+
+  ((memory_block_t **)next_block)[-1] = block;
+  if(!BLOCK_IS_LAST(block))
+    next_block->size |= BLOCK_PREV_FREE_BIT;
+#else
+  (void)block;
+#endif /* MEMORY_COMPACT_HEADER */
+}
+
+/******************************************************************************
+ * block_link_used
+ * Compact header : tell the next physical block that its previous block is
+ * used now
+ *
+ * [in] block : used block
+ *****************************************************************************/
+static inline void block_link_used(memory_block_t *block)
+{
+#if MEMORY_COMPACT_HEADER
+  if(!BLOCK_IS_LAST(block))
+    block_get_physical_next(block)->size &= ~BLOCK_PREV_FREE_BIT;
+#else
+  (void)block;
+#endif /* MEMORY_COMPACT_HEADER */
+}
+
 /******************************************************************************
  * block_insert
- * Insert a block at the head of the free block list
+ * Insert a block at the head of the free block list, or before the first
+ * block above it with the address order
  *
+ * [in] mma   : heap
  * [in] block : block to insert
  *****************************************************************************/
-STATIC void block_insert(memory_block_t * block)
+STATIC void block_insert(memory_management_area_t * mma, memory_block_t * block)
 {
   memory_level_t level;
+  memory_block_t * prev_block = NULL;
+  memory_link_t next_link;
+  PROBE_START(insert);
 
   /* Update  bitmaps */
   block_get_levels(block->size, &level);
-  *mma.first_level |= level.fl_bitmap;
-  mma.second_level[level.fl] |= level.sl_bitmap;
+  mma->first_level |= level.fl_bitmap;
+  MEMORY_SECOND_LEVEL(mma)[level.fl] |= level.sl_bitmap;
 
-  memory_block_t * free_blocks_ptr = mma.fbla[level.fl][level.sl];
-  if(free_blocks_ptr == NULL)
+  next_link = MEMORY_FBLA(mma)[level.fl][level.sl];
+#if MEMORY_ADDRESS_ORDER
+  /* The list is sorted by address, skip the blocks below the block */
+  while((next_link != BLOCK_NO_LINK) && (BLOCK_FROM_LINK(mma, next_link) < block))
   {
-    /* No next block */
-    block->next = NULL;
+    prev_block = BLOCK_FROM_LINK(mma, next_link);
+    next_link = prev_block->next;
+  }
+#endif /* MEMORY_ADDRESS_ORDER */
+
+  /* Update the next block */
+  block->next = next_link;
+  if(next_link != BLOCK_NO_LINK)
+    BLOCK_FROM_LINK(mma, next_link)->prev = BLOCK_TO_LINK(mma, block);
+
+  if(prev_block == NULL)
+  {
+    /* The block is the head of the list */
+    block->prev = BLOCK_NO_LINK;
+    MEMORY_FBLA(mma)[level.fl][level.sl] = BLOCK_TO_LINK(mma, block);
   }
   else
   {
-    /* Update the next block */
-    block->next = free_blocks_ptr;
-    free_blocks_ptr->prev = (struct memory_block_s *)block;
+    block->prev = BLOCK_TO_LINK(mma, prev_block);
+    prev_block->next = BLOCK_TO_LINK(mma, block);
   }
-  block->prev = NULL;
-  mma.fbla[level.fl][level.sl] = block;
   BLOCK_MARK_AS_FREE(block);
+  block_link_free(block);
+
+#if MEMORY_STATS
+  MEMORY_FREE_BLOCKS(mma)[level.fl * MEMORY_SL_COUNT + level.sl]++;
+  mma->stats.free_size += BLOCK_GET_MASKED_SIZE(block);
+#endif /* MEMORY_STATS */
+  PROBE_END(mma, insert);
 }
 
 /******************************************************************************
  * block_extract
  * Extract a block from the free list
  *
+ * [in] mma   : heap
  * [in] block : block to extract
  *****************************************************************************/
-STATIC void block_extract(memory_block_t * block)
+STATIC void block_extract(memory_management_area_t * mma, memory_block_t * block)
 {
   memory_level_t level;
+  PROBE_START(extract);
+
+#if MEMORY_STATS
+  block_get_levels(block->size, &level);
+  MEMORY_FREE_BLOCKS(mma)[level.fl * MEMORY_SL_COUNT + level.sl]--;
+  mma->stats.free_size -= BLOCK_GET_MASKED_SIZE(block);
+#endif /* MEMORY_STATS */
 
-  if(block->prev == NULL)
+  if(block->prev == BLOCK_NO_LINK)
   {
+#if !MEMORY_STATS
     block_get_levels(block->size, &level);
+#endif /* MEMORY_STATS */
     /* It is the first block in the list */
-    if(block->next == NULL)
+    if(block->next == BLOCK_NO_LINK)
     {
       /* Block is alone in the list, update the list and bitmap level */
       /* Set the list as empty */
-      mma.fbla[level.fl][level.sl] = NULL;
+      MEMORY_FBLA(mma)[level.fl][level.sl] = BLOCK_NO_LINK;
 
       /* Adjust second level bitmap */
-      mma.second_level[level.fl] = bit_clear(mma.second_level[level.fl], level.sl);
+      MEMORY_SECOND_LEVEL(mma)[level.fl] = bit_clear(MEMORY_SECOND_LEVEL(mma)[level.fl], level.sl);
       /* Adjust first level bitmap if needed */
-      if(mma.second_level[level.fl] == 0)
-        *mma.first_level = bit_clear(*mma.first_level, level.fl);
+      if(MEMORY_SECOND_LEVEL(mma)[level.fl] == 0)
+        mma->first_level = bit_clear(mma->first_level, level.fl);
     }
     else
     {
       /* Set next block to be the first block */
-      block->next->prev = NULL;
+      BLOCK_FROM_LINK(mma, block->next)->prev = BLOCK_NO_LINK;
       /* Set the next block as the head of the list */
-      mma.fbla[level.fl][level.sl] = block->next;
+      MEMORY_FBLA(mma)[level.fl][level.sl] = block->next;
     }
   }
-  else if(block->next == NULL)
+  else if(block->next == BLOCK_NO_LINK)
   {
     /* It is the last block in the list */
-    block->prev->next = NULL;
+    BLOCK_FROM_LINK(mma, block->prev)->next = BLOCK_NO_LINK;
   }
   else
   {
     /* Block is between two existing block */
-    block->next->prev = block->prev;
-    block->prev->next = block->next;
+    BLOCK_FROM_LINK(mma, block->next)->prev = block->prev;
+    BLOCK_FROM_LINK(mma, block->prev)->next = block->next;
   }
 
   /* Reset list pointer of the extracted block */
-  block->next = NULL;
-  block->prev = NULL;
+  block->next = BLOCK_NO_LINK;
+  block->prev = BLOCK_NO_LINK;
+  PROBE_END(mma, extract);
 }
 
 /******************************************************************************
  * block_find
  * Find a free block in the level
  *
+ * [in] mma   : heap
  * [in] level : level to start the searching of a free block
  *
  * Return null if no free block found else address of free block
  *****************************************************************************/
-STATIC memory_block_t * block_find(memory_level_t *level)
+STATIC memory_block_t * block_find(memory_management_area_t * mma, memory_level_t *level)
 {
+  unsigned long bitmap;
+  PROBE_START(find);
+
+  /* The wanted level is beyond the biggest level of the heap */
+  if(level->fl >= mma->fl_count)
+  {
+    PROBE_COUNT(mma, find_failed);
+    PROBE_END(mma, find);
+    return NULL;
+  }
+
   /* Check if we can found a block in the current level */
-  unsigned long bitmap = mma.second_level[level->fl] & level->sl_bitmap;
+  bitmap = MEMORY_SECOND_LEVEL(mma)[level->fl] & level->sl_bitmap;
 
   if(bitmap == 0)
   {
     /* Not found, check if we can found a greater block in the current second level */
     bitmap = BLOCK_MASK_FREE(level->sl_bitmap);
-    bitmap &= mma.second_level[level->fl];
+    bitmap &= MEMORY_SECOND_LEVEL(mma)[level->fl];
     if(bitmap == 0)
     {
       /* Not found, check if we can found a block in the next first layer */
       bitmap = BLOCK_MASK_FREE(level->fl_bitmap << 1);
-      bitmap &= *mma.first_level;
+      bitmap &= mma->first_level;
       if(bitmap == 0)
-        return NULL; /* No free block available */
+      {
+        /* No free block available */
+        PROBE_COUNT(mma, find_failed);
+        PROBE_END(mma, find);
+        return NULL;
+      }
       else
       {
         /* Find free block in a greater first level */
+        PROBE_COUNT(mma, find_escalated);
         /* Get the first free block */
         level->fl = bit_lowest_pos(bitmap);
-        level->fl_bitmap = 1 << level->fl;
-        level->sl = bit_lowest_pos(mma.second_level[level->fl]);
-        level->sl_bitmap = 1 << level->sl;
+        level->fl_bitmap = 1UL << level->fl;
+        level->sl = bit_lowest_pos(MEMORY_SECOND_LEVEL(mma)[level->fl]);
+        level->sl_bitmap = 1UL << level->sl;
       }
     }
     else
     {
       /* Found free greater block in the next second level */
       level->sl = bit_lowest_pos(bitmap);
-      level->sl_bitmap = 1 << level->sl;
+      level->sl_bitmap = 1UL << level->sl;
     }
   }
-  return mma.fbla[level->fl][level->sl];
-}
-
-/******************************************************************************
- * block_get_physical_next
- * Get the next physical block from the current block
- *
- * [in] block : current block
- *****************************************************************************/
-STATIC inline memory_block_t * block_get_physical_next(memory_block_t *block)
-{
-  return (memory_block_t *)((unsigned long) block + BLOCK_GET_MASKED_SIZE(block) + BLOCK_HEADER_SIZE_USED);
+  PROBE_END(mma, find);
+  return BLOCK_FROM_LINK(mma, MEMORY_FBLA(mma)[level->fl][level->sl]);
 }
 
 /******************************************************************************
  * block_split
  * Split a block
  *
+ * [in] mma   : heap
  * [in] block : block to split
  * [in] size  : size to split the block
  *****************************************************************************/
-STATIC void block_split(memory_block_t *block, unsigned long size)
+STATIC void block_split(memory_management_area_t * mma, memory_block_t *block, unsigned long size)
 {
   memory_block_t * new_free_block;
+  PROBE_START(split);
 
   /* Compute a temporary estimated size */
   unsigned long tmp_size = BLOCK_GET_MASKED_SIZE(block) - size;
@@ -236,9 +777,9 @@ STATIC void block_split(memory_block_t *block, unsigned long size)
     /* Split the block and create the new free block */
     new_free_block = (memory_block_t *)((unsigned long)block + size + BLOCK_HEADER_SIZE_USED);
     new_free_block->size = tmp_size - BLOCK_HEADER_SIZE_USED;
-    new_free_block->next = NULL;
-    new_free_block->prev = NULL;
-    new_free_block->phys_prev = block;
+    new_free_block->next = BLOCK_NO_LINK;
+    new_free_block->prev = BLOCK_NO_LINK;
+    block_set_physical_prev(mma, new_free_block, block);
 
     /* Update block size */
     block->size = size | BLOCK_GET_FLAG_BIT(block);
@@ -253,7 +794,7 @@ STATIC void block_split(memory_block_t *block, unsigned long size)
     else
     {
       /* Update previous pointer of the next block of the new free block */
-      block_get_physical_next(new_free_block)->phys_prev = new_free_block;
+      block_set_physical_prev(mma, block_get_physical_next(new_free_block), new_free_block);
     }
 
     /* Mark blocks */
@@ -261,32 +802,36 @@ STATIC void block_split(memory_block_t *block, unsigned long size)
     BLOCK_MARK_AS_FREE(new_free_block);
 
     /* Insert new free block in the chain list*/
-    block_insert(new_free_block);
+    block_insert(mma, new_free_block);
   }
   else
   {
     /* Can't split, keep the current size */
+    PROBE_COUNT(mma, split_refused);
     BLOCK_MARK_AS_USED(block);
+    block_link_used(block);
   }
+  PROBE_END(mma, split);
 }
 
 /******************************************************************************
  * block_merge_right
  * Merge the current with the physical right block
  *
+ * [in] mma           : heap
  * [in] current_block : Current block to merge
- * [in] right_block   : Right block to merge with the current
  *****************************************************************************/
-STATIC memory_block_t * block_merge_right(memory_block_t * current_block)
+STATIC memory_block_t * block_merge_right(memory_management_area_t * mma, memory_block_t * current_block)
 {
   memory_block_t * right_block;
+  PROBE_START(merge_right);
 
   /* Check for right merge, if the current block is the last, no needs to merge right */
   if(!BLOCK_IS_LAST(current_block))
   {
     /* Check if the next block is free */
     right_block = block_get_physical_next(current_block);
-    if(BLOCK_IS_FREE(right_block))
+    if(BLOCK_IS_FREE(right_block) && !BLOCK_IS_PARKED(right_block))
     {
       /* Right merge */
       if(BLOCK_IS_LAST(right_block))
@@ -298,12 +843,13 @@ STATIC memory_block_t * block_merge_right(memory_block_t * current_block)
       {
         /* Here right_block is not the last block so update
         physical previous pointer of the next block */
-        block_get_physical_next(right_block)->phys_prev = current_block;
+        block_set_physical_prev(mma, block_get_physical_next(right_block), current_block);
       }
-      block_extract(right_block);
+      block_extract(mma, right_block);
       current_block->size += BLOCK_GET_MASKED_SIZE(right_block) + BLOCK_HEADER_SIZE_USED;
     }
   }
+  PROBE_END(mma, merge_right);
   return current_block;
 }
 
@@ -311,18 +857,19 @@ STATIC memory_block_t * block_merge_right(memory_block_t * current_block)
  * block_merge_left
  * Merge the current with the physical left block
  *
+ * [in] mma           : heap
  * [in] current_block : Current block to merge
- * [in] left_block    : Left block to merge with the current
  *****************************************************************************/
-STATIC memory_block_t * block_merge_left(memory_block_t * current_block)
+STATIC memory_block_t * block_merge_left(memory_management_area_t * mma, memory_block_t * current_block)
 {
-  memory_block_t * left_block = current_block->phys_prev;
+  memory_block_t * left_block = block_get_physical_prev(mma, current_block);
+  PROBE_START(merge_left);
 
   /* If left block is null means block is the first physical block, so no left merge */
   if(left_block != NULL)
   {
     /* Check for left merge */
-    if(BLOCK_IS_FREE(left_block))
+    if(BLOCK_IS_FREE(left_block) && !BLOCK_IS_PARKED(left_block))
     {
       if(BLOCK_IS_LAST(current_block))
       {
@@ -332,141 +879,1575 @@ STATIC memory_block_t * block_merge_left(memory_block_t * current_block)
       {
         /* block is not the last block so update physical previous
         pointer of the next block */
-        block_get_physical_next(current_block)->phys_prev = left_block;
+        block_set_physical_prev(mma, block_get_physical_next(current_block), left_block);
       }
-      block_extract(left_block);
+      block_extract(mma, left_block);
       left_block->size += BLOCK_GET_MASKED_SIZE(current_block) + BLOCK_HEADER_SIZE_USED;
+      PROBE_END(mma, merge_left);
       return left_block;
     }
   }
+  PROBE_END(mma, merge_left);
   return  current_block;
 }
 
-
 /******************************************************************************
- * memory_init
- * Memory initialization. Prepare the memory structure
+ * defer_flush
+ * Merge all the parked blocks and put them in the free lists
  *
- * [in] mem_ptr : memory pointer
- * [in] length  : size of the memory
+ * [in] mma : heap
+ *
+ * Return the number of merged blocks
  *****************************************************************************/
-unsigned long memory_init(void * address, unsigned long length)
+STATIC unsigned long defer_flush(memory_management_area_t * mma)
 {
-  memory_block_t * first_block;
-  unsigned reset_size;
-  unsigned long mma_area_size;
-  unsigned long level_max = bit_highest_pos(bit_next_power_of_two((unsigned long)length)) - 6;
+#if MEMORY_DEFER
+  memory_block_t * block;
+  memory_block_t * merged_block;
+  unsigned long count = mma->defer_count;
+  unsigned long index;
+  unsigned long size;
 
-  /* Align memory header address and size to be modulo 32 bits */
-  if((unsigned long)address & ALIGN_MASK)
-  {
-    /* address is not aligned */
-    address = (void *)RESIZE_UP(address, LONG_SIZE_BYTE);
-    length -= LONG_SIZE_BYTE;
-  }
-  else
+  for(index = 0; (index < MEMORY_DEFER_CLASS_COUNT) && (mma->defer_count > 0); index++)
   {
-    length = RESIZE_DOWN(length, LONG_SIZE_BYTE);
-  }
-
-  /* Set the first level in the MMA */
-  mma.first_level = (unsigned long *)address;
-  mma_area_size = 4;
+    while(mma->deferred[index] != BLOCK_NO_LINK)
+    {
+      block = BLOCK_FROM_LINK(mma, mma->deferred[index]);
+      mma->deferred[index] = block->next;
+      mma->defer_count--;
+#if MEMORY_STATS
+      mma->stats.free_size -= BLOCK_GET_MASKED_SIZE(block);
+#endif /* MEMORY_STATS */
 
-  /* Set the second level in the MMA */
-  mma.second_level = (unsigned long *)((unsigned long)address + mma_area_size);
-  mma_area_size += level_max * 4;
+      /* Parked neighbours are skipped, they merge with this block later */
+      block->prev = BLOCK_NO_LINK;
+      size = block->size;
+      merged_block = block_merge_left(mma, block_merge_right(mma, block));
+      probe_coalesce(mma, merged_block != block, block->size != size);
+      block_insert(mma, merged_block);
+    }
+  }
+  return count;
+#else
+  (void)mma;
+  return 0;
+#endif /* MEMORY_DEFER */
+}
 
-  /* Set the second level in the MMA */
-  mma.fbla = (memory_block_t *(*)[32])((unsigned long)address + mma_area_size);
-  mma_area_size += level_max * (32 * 4);
+/******************************************************************************
+ * defer_park
+ * Park a freed block without merging it. The backlog is merged first when
+ * it is full, so a free merges at most defer_limit blocks
+ *
+ * [in] mma   : heap
+ * [in] block : freed block
+ *
+ * Return 1 if the block is parked, 0 if it must be merged now
+ *****************************************************************************/
+static inline unsigned long defer_park(memory_management_area_t * mma, memory_block_t * block)
+{
+#if MEMORY_DEFER
+  unsigned long index = BLOCK_GET_MASKED_SIZE(block) >> MEMORY_ALIGN_LOG2;
 
-  /* Check the size */
-  if((mma_area_size + BLOCK_MIN_SIZE) > length)
+  if((BLOCK_GET_MASKED_SIZE(block) > MEMORY_DEFER_MAX_SIZE) || (mma->defer_limit == 0))
     return 0;
+  if(mma->defer_count >= mma->defer_limit)
+    defer_flush(mma);
 
-  /* Reset the MMA area */
-  for(reset_size = 0; reset_size < mma_area_size; reset_size++)
-    mma.first_level[reset_size] = 0;
-
-  /* Set the first free block in memory block area */
-  first_block = (memory_block_t *)((unsigned long)address + mma_area_size);
-
-  /* Set the size of the fisrt block */
-  first_block->size = length - mma_area_size - BLOCK_HEADER_SIZE_USED;
-
-  /* Put in place the first block in the chain list */
-  block_insert(first_block);
-
-  /* No previous physical block */
-  first_block->phys_prev = NULL;
-
-  /* Mark the block as last */
-  BLOCK_MARK_AS_LAST(first_block);
-
+  BLOCK_MARK_AS_FREE(block);
+  block->prev = BLOCK_PARKED_LINK;
+  block->next = mma->deferred[index];
+  mma->deferred[index] = BLOCK_TO_LINK(mma, block);
+  mma->defer_count++;
+#if MEMORY_STATS
+  mma->stats.free_size += BLOCK_GET_MASKED_SIZE(block);
+#endif /* MEMORY_STATS */
   return 1;
+#else
+  (void)mma;
+  (void)block;
+  return 0;
+#endif /* MEMORY_DEFER */
 }
 
 /******************************************************************************
- * memory_alloc
- * Memory allocation
+ * defer_take
+ * Take a parked block of exactly the wanted size
  *
- * [in] size : size of the memory to allocate (in byte)
+ * [in] mma  : heap
+ * [in] size : wanted size (aligned)
  *
- * Return the pointer of the allocated size or null if error
+ * Return the block marked as used or null if no block of this size is parked
  *****************************************************************************/
-void * memory_alloc(unsigned long size)
+static inline memory_block_t * defer_take(memory_management_area_t * mma, unsigned long size)
 {
+#if MEMORY_DEFER
+  memory_block_t * block;
+
+  if((size > MEMORY_DEFER_MAX_SIZE) || (mma->deferred[size >> MEMORY_ALIGN_LOG2] == BLOCK_NO_LINK))
+    return NULL;
+
+  block = BLOCK_FROM_LINK(mma, mma->deferred[size >> MEMORY_ALIGN_LOG2]);
+  mma->deferred[size >> MEMORY_ALIGN_LOG2] = block->next;
+  mma->defer_count--;
+  block->prev = BLOCK_NO_LINK;
+  block->next = BLOCK_NO_LINK;
+  BLOCK_MARK_AS_USED(block);
+#if MEMORY_STATS
+  mma->stats.free_size -= BLOCK_GET_MASKED_SIZE(block);
+#endif /* MEMORY_STATS */
+  return block;
+#else
+  (void)mma;
+  (void)size;
+  return NULL;
+#endif /* MEMORY_DEFER */
+}
+
+/******************************************************************************
+ * defer_find
+ * Find a free block in the level, the parked blocks are merged and the
+ * search is done again when it fails
+ *
+ * [in] mma   : heap
+ * [in] level : level to start the searching of a free block
+ *
+ * Return null if no free block found else address of free block
+ *****************************************************************************/
+static inline memory_block_t * defer_find(memory_management_area_t * mma, memory_level_t *level)
+{
+  memory_block_t * block = block_find(mma, level);
+
+  if((block == NULL) && (defer_flush(mma) > 0))
+    block = block_find(mma, level);
+  return block;
+}
+
+/******************************************************************************
+ * fit_find
+ * Good fit : look for a block big enough in the first blocks of the list of
+ * the size. The search from the next level never takes them, a block of
+ * this list may be smaller than the size
+ *
+ * [in] mma  : heap
+ * [in] size : wanted size (aligned)
+ *
+ * Return null if no block of the list fits else address of the free block
+ *****************************************************************************/
+static inline memory_block_t * fit_find(memory_management_area_t * mma, unsigned long size)
+{
+#if MEMORY_GOOD_FIT
   memory_level_t level;
-  memory_block_t * new_block;
+  memory_block_t * block;
+  memory_link_t link;
+  unsigned long scan;
+
+  if(mma->fit_scan == 0)
+    return NULL;
+
+  block_get_levels(size, &level);
+  if((level.fl >= mma->fl_count) || ((MEMORY_SECOND_LEVEL(mma)[level.fl] & level.sl_bitmap) == 0))
+    return NULL;
+
+  link = MEMORY_FBLA(mma)[level.fl][level.sl];
+  for(scan = 0; (scan < mma->fit_scan) && (link != BLOCK_NO_LINK); scan++)
+  {
+    block = BLOCK_FROM_LINK(mma, link);
+    if(BLOCK_GET_MASKED_SIZE(block) >= size)
+    {
+      PROBE_COUNT(mma, fit_found);
+#if MEMORY_PROBES
+      mma->probes.fit_scanned += scan + 1;
+#endif /* MEMORY_PROBES */
+      return block;
+    }
+    link = block->next;
+  }
+  PROBE_COUNT(mma, fit_missed);
+#if MEMORY_PROBES
+  mma->probes.fit_scanned += scan;
+#endif /* MEMORY_PROBES */
+  return NULL;
+#else
+  (void)mma;
+  (void)size;
+  return NULL;
+#endif /* MEMORY_GOOD_FIT */
+}
+
+/******************************************************************************
+ * pool_in_reach
+ * Check that the links of the blocks of a memory area fit in a block header.
+ * The offset links need blocks smaller than 4 GiB and within MEMORY_LINK_REACH
+ * of the heap control block
+ *
+ * [in] mma     : heap (the control block, it may not be set up yet)
+ * [in] address : memory pointer (aligned)
+ * [in] length  : size of the memory (aligned)
+ *
+ * Return 1 if the memory can be used by the heap, 0 otherwise
+ *****************************************************************************/
+static inline unsigned long pool_in_reach(memory_management_area_t * mma, void * address, unsigned long length)
+{
+#if MEMORY_OFFSET_LINKS
+  unsigned long start = (unsigned long)address;
+  unsigned long base = (unsigned long)mma;
+
+  if(length > 0xFFFFFFFFUL)
+    return 0;
+  if(start >= base)
+    return ((start + length - base) <= MEMORY_LINK_REACH) ? 1 : 0;
+  return ((base - start) <= MEMORY_LINK_REACH) ? 1 : 0;
+#else
+  (void)mma;
+  (void)address;
+  (void)length;
+  return 1;
+#endif /* MEMORY_OFFSET_LINKS */
+}
+
+/******************************************************************************
+ * memory_heap_init
+ * Heap initialization. Prepare the heap control block at the start of the
+ * memory area and put the remaining memory in a single free block
+ *
+ * [in] address : memory pointer
+ * [in] length  : size of the memory
+ *
+ * Return the heap or null if the memory is too small (or too big for the
+ * offset links)
+ *****************************************************************************/
+memory_management_area_t * memory_heap_init(void * address, unsigned long length)
+{
+  memory_management_area_t * heap;
+  memory_block_t * first_block;
+  unsigned long reset_size;
+  unsigned long mma_area_size;
+  unsigned long level_max;
+
+  /* Align memory header address and size to be modulo 32 bits */
+  if((unsigned long)address & ALIGN_MASK)
+  {
+    /* address is not aligned */
+    address = (void *)RESIZE_UP(address, LONG_SIZE_BYTE);
+    length -= LONG_SIZE_BYTE;
+  }
+  else
+  {
+    length = RESIZE_DOWN(length, LONG_SIZE_BYTE);
+  }
+
+  if(!pool_in_reach((memory_management_area_t *)address, address, length))
+    return NULL;
+
+  level_table_init();
+
+  /* Number of first levels needed for the memory size */
+  if(length < (1UL << MEMORY_FL_SHIFT))
+    level_max = 1;
+  else
+    level_max = bit_highest_pos(bit_next_power_of_two(length)) - MEMORY_FL_SHIFT + 1;
+
+  /* The heap control block is at the start of the memory */
+  heap = (memory_management_area_t *)address;
+  mma_area_size = sizeof(memory_management_area_t);
+
+  /* Set the second level after the control block */
+  mma_area_size += level_max * LONG_SIZE_BYTE;
+
+  /* Set the free block list array after the second level */
+  mma_area_size += level_max * sizeof(*MEMORY_FBLA(heap));
+
+#if MEMORY_STATS
+  /* Set the free block histogram after the free block list array */
+  mma_area_size += level_max * MEMORY_SL_COUNT * LONG_SIZE_BYTE;
+#endif /* MEMORY_STATS */
+
+  /* The chunk of the first block is aligned */
+  mma_area_size = (unsigned long)BLOCK_ALIGN_START((unsigned long)address + mma_area_size) - (unsigned long)address;
+
+  /* Check the size */
+  if((mma_area_size > length) || (RESIZE_DOWN(length - mma_area_size, MEMORY_CHUNK_ALIGN) < BLOCK_MIN_SIZE))
+    return NULL;
+
+  /* Reset the MMA area */
+  for(reset_size = 0; reset_size < (mma_area_size / LONG_SIZE_BYTE); reset_size++)
+    ((unsigned long *)address)[reset_size] = 0;
+
+  heap->fl_count = level_max;
+
+  /* The whole memory is the first pool */
+  heap->pool_count = 1;
+  heap->pools[0].start = 0;
+  heap->pools[0].end = length;
+
+#if MEMORY_STATS
+  heap->stats.fl_count = level_max;
+#endif /* MEMORY_STATS */
+
+  /* Set the first free block in memory block area */
+  first_block = (memory_block_t *)((unsigned long)address + mma_area_size);
+
+  /* Set the size of the fisrt block */
+  first_block->size = RESIZE_DOWN(length - mma_area_size, MEMORY_CHUNK_ALIGN) - BLOCK_HEADER_SIZE_USED;
+
+  /* No previous physical block */
+  block_set_physical_prev(heap, first_block, NULL);
+
+  /* Mark the block as last */
+  BLOCK_MARK_AS_LAST(first_block);
+
+  /* Put in place the first block in the chain list */
+  block_insert(heap, first_block);
+
+#if MEMORY_DEFER
+  heap->defer_limit = MEMORY_DEFER_BACKLOG;
+#endif /* MEMORY_DEFER */
+
+#if MEMORY_GOOD_FIT
+  heap->fit_scan = MEMORY_GOOD_FIT_SCAN;
+#endif /* MEMORY_GOOD_FIT */
+
+#if MEMORY_LOCK == MEMORY_LOCK_MUTEX
+  pthread_mutex_init(&heap->lock, NULL);
+#endif /* MEMORY_LOCK */
+
+  return heap;
+}
+
+/******************************************************************************
+ * memory_heap_alloc
+ * Memory allocation in a heap
+ *
+ * [in] mma  : heap
+ * [in] size : size of the memory to allocate (in byte)
+ *
+ * Return the pointer of the allocated size or null if error
+ *****************************************************************************/
+void * memory_heap_alloc(memory_management_area_t * mma, unsigned long size)
+{
+  memory_level_t level;
+
+  /* No block is that big, its rounding would wrap around */
+  if(size > SIZE_ROUND_MAX)
+    return NULL;
 
   /* As minimum block size is 16 bytes, check the size */
   if(size > BLOCK_MIN_SIZE)
   {
     /* Size must have the last two bits at 0 due to free and last bit flags */
-    size = RESIZE_UP(size, LONG_SIZE_BYTE);
+    size = BLOCK_ROUND_SIZE(size);
     /* Get the next level  to be sur to have the minimum required size */
     block_get_next_level(size, &level);
   }
   else
   {
-    size = BLOCK_MIN_SIZE;
-    level.fl = 0;
-    level.fl_bitmap = 1;
-    level.sl = 4;
-    level.sl_bitmap = 16;
+    size = BLOCK_MIN_ALLOC_SIZE;
+    /* Every block of the minimum size level is big enough */
+    block_get_levels(size, &level);
+  }
+
+  return memory_heap_alloc_level(mma, size, &level);
+}
+
+/******************************************************************************
+ * memory_heap_alloc_level
+ * Memory allocation in a heap with the block size and the level computed by
+ * the caller, like memory_heap_alloc does : the size rounded up by
+ * BLOCK_ROUND_SIZE (BLOCK_MIN_ALLOC_SIZE up to BLOCK_MIN_SIZE) and the next
+ * level of the size (the level of BLOCK_MIN_ALLOC_SIZE for the minimum size).
+ * fma32.hpp computes them at compile time for the constant sizes
+ *
+ * [in] mma   : heap
+ * [in] size  : size of the block
+ * [in] level : level where all the blocks are big enough for the size
+ *
+ * Return the pointer of the allocated size or null if error
+ *****************************************************************************/
+void * memory_heap_alloc_level(memory_management_area_t * mma, unsigned long size, const memory_level_t * level)
+{
+  memory_level_t search = *level;
+  memory_block_t * new_block;
+
+  heap_lock(mma);
+
+  /* A parked block of the same size is given back as is */
+  new_block = defer_take(mma, size);
+  if(new_block != NULL)
+  {
+    stats_alloc(mma, BLOCK_GET_MASKED_SIZE(new_block));
+    heap_unlock(mma);
+    return (void *)((unsigned long)new_block + BLOCK_HEADER_SIZE_USED);
   }
 
-  /* Check if exists a free block */
-  new_block = block_find(&level);
+  /* Check if exists a free block, in the list of the size first with the good fit */
+  new_block = fit_find(mma, size);
+  if(new_block == NULL)
+    new_block = defer_find(mma, &search);
 
   /* If not return null */
   if(new_block == NULL)
+  {
+    stats_fail(mma);
+    heap_unlock(mma);
     return NULL;
+  }
 
   /* Extract free block from the chain list */
-  block_extract(new_block);
+  block_extract(mma, new_block);
 
   /* Split the new block */
-  block_split(new_block, size);
+  block_split(mma, new_block, size);
+
+  stats_alloc(mma, BLOCK_GET_MASKED_SIZE(new_block));
+  heap_unlock(mma);
 
   return (void *)((unsigned long)new_block + BLOCK_HEADER_SIZE_USED);
 }
 
 /******************************************************************************
- * memory_free
- * Free a memory previously allocated
+ * memory_heap_free
+ * Free a memory previously allocated in a heap
  *
+ * [in] mma : heap
  * [in] ptr : pointer the memory to free
  *****************************************************************************/
-void memory_free(void * ptr)
+void memory_heap_free(memory_management_area_t * mma, void * ptr)
 {
   memory_block_t *current_block = (memory_block_t *) ((unsigned long) ptr - BLOCK_HEADER_SIZE_USED);
+  memory_block_t * merged_block;
+  unsigned long size;
+
+  heap_lock(mma);
 
   /* Check if the current block is used */
   if(BLOCK_IS_FREE(current_block))
+  {
+    heap_unlock(mma);
+    return;
+  }
+
+  stats_free(mma, BLOCK_GET_MASKED_SIZE(current_block));
+  if(defer_park(mma, current_block))
+  {
+    heap_unlock(mma);
     return;
+  }
+
+  size = current_block->size;
+  merged_block = block_merge_left(mma, block_merge_right(mma, current_block));
+  probe_coalesce(mma, merged_block != current_block, current_block->size != size);
+  block_insert(mma, merged_block);
+
+  heap_unlock(mma);
+}
+
+/******************************************************************************
+ * memory_heap_memalign
+ * Aligned memory allocation in a heap. The misaligned head of the found
+ * block is split off as a free block
+ *
+ * [in] mma       : heap
+ * [in] alignment : alignment of the memory (power of two)
+ * [in] size      : size of the memory to allocate (in byte)
+ *
+ * Return the aligned pointer of the allocated size or null if error
+ *****************************************************************************/
+void * memory_heap_memalign(memory_management_area_t * mma, unsigned long alignment, unsigned long size)
+{
+  memory_level_t level;
+  memory_block_t * new_block;
+  memory_block_t * aligned_block;
+  unsigned long gap;
+
+  /* Every chunk is aligned on MEMORY_CHUNK_ALIGN */
+  if(alignment <= MEMORY_CHUNK_ALIGN)
+    return memory_heap_alloc(mma, size);
+  if(!is_power_of_two(alignment))
+    return NULL;
+  /* The size rounded up and padded for the head must not wrap around */
+  if(size > SIZE_ROUND_MAX - alignment - BLOCK_MIN_SIZE)
+    return NULL;
+
+  if(size < BLOCK_MIN_SIZE)
+    size = BLOCK_MIN_ALLOC_SIZE;
+  else
+    size = BLOCK_ROUND_SIZE(size);
+
+  /* Look for a block big enough for the size and the biggest head */
+  block_get_next_level(size + alignment + BLOCK_MIN_SIZE, &level);
+
+  heap_lock(mma);
+
+  new_block = defer_find(mma, &level);
+  if(new_block == NULL)
+  {
+    stats_fail(mma);
+    heap_unlock(mma);
+    return NULL;
+  }
+  block_extract(mma, new_block);
+
+  /* The head must be empty or big enough to be a free block */
+  gap = RESIZE_UP((unsigned long)new_block + BLOCK_HEADER_SIZE_USED, alignment) - ((unsigned long)new_block + BLOCK_HEADER_SIZE_USED);
+  if((gap != 0) && (gap < BLOCK_MIN_SIZE))
+    gap += RESIZE_UP(BLOCK_MIN_SIZE - gap, alignment);
+
+  if(gap != 0)
+  {
+    /* Split the head off */
+    aligned_block = (memory_block_t *)((unsigned long)new_block + gap);
+    aligned_block->size = BLOCK_GET_MASKED_SIZE(new_block) - gap;
+    block_set_physical_prev(mma, aligned_block, new_block);
+    if(BLOCK_IS_LAST(new_block))
+    {
+      BLOCK_MARK_AS_LAST(aligned_block);
+    }
+    else
+    {
+      block_set_physical_prev(mma, block_get_physical_next(aligned_block), aligned_block);
+    }
+    new_block->size = (gap - BLOCK_HEADER_SIZE_USED) | BLOCK_GET_PREV_FREE_BIT(new_block);
+    block_insert(mma, new_block);
+    new_block = aligned_block;
+  }
+
+  /* Split the tail off */
+  block_split(mma, new_block, size);
+
+  stats_alloc(mma, BLOCK_GET_MASKED_SIZE(new_block));
+  heap_unlock(mma);
+
+  return (void *)((unsigned long)new_block + BLOCK_HEADER_SIZE_USED);
+}
+
+/******************************************************************************
+ * memory_heap_try_expand
+ * Resize an allocated memory without moving it. Growing absorbs the free
+ * physical right block, the unused tail goes back to the free lists
+ *
+ * [in] mma  : heap
+ * [in] ptr  : pointer the allocated memory
+ * [in] size : new size of the memory (in byte)
+ *
+ * Return 1 if the memory has now the new size, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_heap_try_expand(memory_management_area_t * mma, void * ptr, unsigned long size)
+{
+  memory_block_t * block = (memory_block_t *)((unsigned long)ptr - BLOCK_HEADER_SIZE_USED);
+  memory_block_t * right_block;
+  unsigned long available;
+
+  /* No block is that big, its rounding would wrap around */
+  if(size > SIZE_ROUND_MAX)
+    return 0;
+
+  if(size < BLOCK_MIN_SIZE)
+    size = BLOCK_MIN_ALLOC_SIZE;
+  else
+    size = BLOCK_ROUND_SIZE(size);
+
+  heap_lock(mma);
+
+  /* Size available with the right block if it is free */
+  available = BLOCK_GET_MASKED_SIZE(block);
+  if(!BLOCK_IS_LAST(block))
+  {
+    right_block = block_get_physical_next(block);
+    if(BLOCK_IS_FREE(right_block) && !BLOCK_IS_PARKED(right_block))
+      available += BLOCK_GET_MASKED_SIZE(right_block) + BLOCK_HEADER_SIZE_USED;
+  }
+
+  if(available < size)
+  {
+    heap_unlock(mma);
+    return 0;
+  }
+
+  /* Absorb the right block and give back the tail */
+  available = BLOCK_GET_MASKED_SIZE(block);
+  block_merge_right(mma, block);
+  block_split(mma, block, size);
+  stats_resize(mma, available, BLOCK_GET_MASKED_SIZE(block));
 
-  block_insert(block_merge_left(block_merge_right(current_block)));
+  heap_unlock(mma);
+  return 1;
+}
+
+/******************************************************************************
+ * memory_heap_realloc
+ * Change the size of an allocated memory in a heap. The memory is resized in
+ * place if possible, else it is moved to a new block
+ *
+ * [in] mma  : heap
+ * [in] ptr  : pointer the allocated memory (null to allocate)
+ * [in] size : new size of the memory (in byte, 0 to free)
+ *
+ * Return the pointer of the memory or null if error (the memory is unchanged)
+ *****************************************************************************/
+void * memory_heap_realloc(memory_management_area_t * mma, void * ptr, unsigned long size)
+{
+  unsigned long * new_ptr;
+  unsigned long copy_size;
+  unsigned long index;
+
+  if(ptr == NULL)
+    return memory_heap_alloc(mma, size);
+
+  if(size == 0)
+  {
+    memory_heap_free(mma, ptr);
+    return NULL;
+  }
+
+  /* No block is that big, the memory is kept */
+  if(size > SIZE_ROUND_MAX)
+    return NULL;
+
+  if(memory_heap_try_expand(mma, ptr, size))
+    return ptr;
+
+  new_ptr = (unsigned long *)memory_heap_alloc(mma, size);
+  if(new_ptr == NULL)
+    return NULL;
+
+  /* Only grow moves the memory, copy all the old block */
+  copy_size = memory_usable_size(ptr) / LONG_SIZE_BYTE;
+  for(index = 0; index < copy_size; index++)
+    new_ptr[index] = ((unsigned long *)ptr)[index];
+
+  memory_heap_free(mma, ptr);
+  return new_ptr;
+}
+
+/******************************************************************************
+ * block_carve
+ * Cut an extracted free block in consecutive used blocks of the same size,
+ * the tail after the last block goes back to the free lists
+ *
+ * [in] mma   : heap
+ * [in] block : extracted free block
+ * [in] size  : size of each block (normalized)
+ * [in] count : number of blocks, they must fit in the free block
+ * [out] out  : pointers of the blocks
+ *****************************************************************************/
+STATIC void block_carve(memory_management_area_t * mma, memory_block_t * block, unsigned long size, unsigned long count, void ** out)
+{
+  memory_block_t * next_block;
+  unsigned long remaining = BLOCK_GET_MASKED_SIZE(block);
+  unsigned long last = BLOCK_IS_LAST(block);
+  unsigned long prev_free = BLOCK_GET_PREV_FREE_BIT(block);
+  unsigned long index;
+
+  for(index = 0; index < count - 1; index++)
+  {
+    /* The next block starts just after this one */
+    next_block = (memory_block_t *)((unsigned long)block + size + BLOCK_HEADER_SIZE_USED);
+    block_set_physical_prev(mma, next_block, block);
+    remaining -= size + BLOCK_HEADER_SIZE_USED;
+    block->size = size | prev_free;
+    prev_free = 0;
+    out[index] = (void *)((unsigned long)block + BLOCK_HEADER_SIZE_USED);
+    block = next_block;
+  }
+
+  /* The last block takes the rest and gives back its tail */
+  block->size = remaining | prev_free;
+  if(last)
+    BLOCK_MARK_AS_LAST(block);
+  else
+    block_set_physical_prev(mma, block_get_physical_next(block), block);
+  block_split(mma, block, size);
+  out[index] = (void *)((unsigned long)block + BLOCK_HEADER_SIZE_USED);
+}
+
+/******************************************************************************
+ * memory_heap_alloc_batch
+ * Allocate several memories of the same size in a heap. The blocks are cut
+ * from one big free block when it is possible
+ *
+ * [in] mma   : heap
+ * [in] size  : size of each memory (in byte)
+ * [in] count : number of memories
+ * [out] out  : pointers of the allocated memories
+ *
+ * Return the number of allocated memories (less than count if the heap is full)
+ *****************************************************************************/
+unsigned long memory_heap_alloc_batch(memory_management_area_t * mma, unsigned long size, unsigned long count, void ** out)
+{
+  memory_level_t level;
+  memory_block_t * block;
+  unsigned long done = 0;
+  unsigned long fit;
+
+  /* No block is that big, its rounding or its header would wrap around */
+  if(size > SIZE_ROUND_MAX - BLOCK_HEADER_SIZE_USED)
+    return 0;
+
+  if(size > BLOCK_MIN_SIZE)
+    size = BLOCK_ROUND_SIZE(size);
+  else
+    size = BLOCK_MIN_ALLOC_SIZE;
+
+  heap_lock(mma);
+
+  while(done < count)
+  {
+    /* Look for a block for all the remaining memories, unless their size wraps around */
+    if(((count - done) <= ULONG_MAX / (size + BLOCK_HEADER_SIZE_USED)) &&
+       block_get_next_level((count - done) * (size + BLOCK_HEADER_SIZE_USED) - BLOCK_HEADER_SIZE_USED, &level))
+      block = block_find(mma, &level);
+    else
+      block = NULL;
+
+    if(block == NULL)
+    {
+      /* Else take the biggest part of the batch from a block for one memory */
+      if(size > BLOCK_MIN_ALLOC_SIZE)
+        block_get_next_level(size, &level);
+      else
+        block_get_levels(size, &level);
+      block = defer_find(mma, &level);
+      if(block == NULL)
+      {
+        stats_fail(mma);
+        break;
+      }
+    }
+
+    /* A block which holds no memory is a miss, it stays in the free lists */
+    fit = (BLOCK_GET_MASKED_SIZE(block) + BLOCK_HEADER_SIZE_USED) / (size + BLOCK_HEADER_SIZE_USED);
+    if(fit == 0)
+    {
+      stats_fail(mma);
+      break;
+    }
+    if(fit > count - done)
+      fit = count - done;
+    block_extract(mma, block);
+    block_carve(mma, block, size, fit, &out[done]);
+    for(; fit > 0; fit--, done++)
+      stats_alloc(mma, memory_usable_size(out[done]));
+  }
+
+  heap_unlock(mma);
+  return done;
 }
 
+/******************************************************************************
+ * pointer_sort
+ * Sort pointers by address. Batches are often in allocation order or in
+ * reverse order, they are detected first; the others use an insertion sort
+ *
+ * [in] ptrs  : pointers to sort
+ * [in] count : number of pointers
+ *****************************************************************************/
+STATIC void pointer_sort(void ** ptrs, unsigned long count)
+{
+  unsigned long index;
+  unsigned long pos;
+  void * ptr;
+
+  if(count < 2)
+    return;
+
+  /* Reversed order */
+  for(index = 1; (index < count) && ((unsigned long)ptrs[index - 1] >= (unsigned long)ptrs[index]); index++);
+  if(index == count)
+  {
+    for(index = 0; index < count / 2; index++)
+    {
+      ptr = ptrs[index];
+      ptrs[index] = ptrs[count - 1 - index];
+      ptrs[count - 1 - index] = ptr;
+    }
+    return;
+  }
+
+  /* The sorted head is kept, insert the others */
+  for(index = 1; (index < count) && ((unsigned long)ptrs[index - 1] <= (unsigned long)ptrs[index]); index++);
+  for(; index < count; index++)
+  {
+    ptr = ptrs[index];
+    for(pos = index; (pos > 0) && ((unsigned long)ptrs[pos - 1] > (unsigned long)ptr); pos--)
+      ptrs[pos] = ptrs[pos - 1];
+    ptrs[pos] = ptr;
+  }
+}
+
+/******************************************************************************
+ * memory_heap_free_batch
+ * Free several memories of a heap. The pointers are sorted by address and the
+ * runs of physically adjacent blocks are merged before going to the free
+ * lists, so the lists and bitmaps are updated once per run
+ *
+ * [in] mma   : heap
+ * [in] ptrs  : pointers the memories to free (sorted in place, null ignored)
+ * [in] count : number of pointers
+ *****************************************************************************/
+void memory_heap_free_batch(memory_management_area_t * mma, void ** ptrs, unsigned long count)
+{
+  memory_block_t * run_block;
+  memory_block_t * next_block;
+  memory_block_t * merged_block;
+  unsigned long size;
+  unsigned long index = 0;
+
+  pointer_sort(ptrs, count);
+
+  heap_lock(mma);
+
+  while(index < count)
+  {
+    /* Skip null and repeated pointers */
+    if((ptrs[index] == NULL) || ((index > 0) && (ptrs[index] == ptrs[index - 1])))
+    {
+      index++;
+      continue;
+    }
+    run_block = (memory_block_t *)((unsigned long)ptrs[index] - BLOCK_HEADER_SIZE_USED);
+    index++;
+    if(BLOCK_IS_FREE(run_block))
+      continue;
+    stats_free(mma, BLOCK_GET_MASKED_SIZE(run_block));
+
+    /* Absorb the following blocks while they are the physical next ones */
+    while((index < count) && !BLOCK_IS_LAST(run_block))
+    {
+      if(ptrs[index] == ptrs[index - 1])
+      {
+        index++;
+        continue;
+      }
+      next_block = (memory_block_t *)((unsigned long)ptrs[index] - BLOCK_HEADER_SIZE_USED);
+      if((next_block != block_get_physical_next(run_block)) || BLOCK_IS_FREE(next_block))
+        break;
+
+      stats_free(mma, BLOCK_GET_MASKED_SIZE(next_block));
+      if(BLOCK_IS_LAST(next_block))
+        BLOCK_MARK_AS_LAST(run_block);
+      else
+        block_set_physical_prev(mma, block_get_physical_next(next_block), run_block);
+      run_block->size += BLOCK_GET_MASKED_SIZE(next_block) + BLOCK_HEADER_SIZE_USED;
+      index++;
+    }
+
+    size = run_block->size;
+    merged_block = block_merge_left(mma, block_merge_right(mma, run_block));
+    probe_coalesce(mma, merged_block != run_block, run_block->size != size);
+    block_insert(mma, merged_block);
+  }
+
+  heap_unlock(mma);
+}
+
+/******************************************************************************
+ * memory_usable_size
+ * Get the usable size of an allocated memory
+ *
+ * [in] ptr : pointer the allocated memory
+ *
+ * Return the number of bytes that can be used
+ *****************************************************************************/
+unsigned long memory_usable_size(void * ptr)
+{
+  return BLOCK_GET_MASKED_SIZE((memory_block_t *)((unsigned long)ptr - BLOCK_HEADER_SIZE_USED));
+}
+
+/******************************************************************************
+ * memory_heap_get_lock_stats
+ * Get the lock contention counters of a heap. Without lock policy all the
+ * counters are 0
+ *
+ * [in] mma    : heap
+ * [out] stats : lock counters
+ *****************************************************************************/
+void memory_heap_get_lock_stats(memory_management_area_t * mma, memory_lock_stats_t * stats)
+{
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+  *stats = mma->lock_stats;
+#else
+  (void)mma;
+  stats->acquire_count = 0;
+  stats->contended_count = 0;
+  stats->spin_count = 0;
+  stats->wait_ns = 0;
+#endif /* MEMORY_LOCK */
+}
+
+/******************************************************************************
+ * memory_heap_lock
+ * Hold the lock of a heap, the heap calls of the thread wait until
+ * memory_heap_unlock. It keeps the heap consistent across a fork
+ *
+ * [in] mma : heap
+ *****************************************************************************/
+void memory_heap_lock(memory_management_area_t * mma)
+{
+  heap_lock(mma);
+}
+
+/******************************************************************************
+ * memory_heap_unlock
+ * Release the lock of a heap held by memory_heap_lock
+ *
+ * [in] mma : heap
+ *****************************************************************************/
+void memory_heap_unlock(memory_management_area_t * mma)
+{
+  heap_unlock(mma);
+}
+
+/******************************************************************************
+ * memory_heap_get_stats
+ * Get the allocation statistics of a heap. Without MEMORY_STATS all the
+ * counters are 0 and there is no free block histogram
+ *
+ * [in] mma    : heap
+ * [out] stats : statistics
+ *****************************************************************************/
+void memory_heap_get_stats(memory_management_area_t * mma, memory_stats_t * stats)
+{
+#if MEMORY_STATS
+  heap_lock(mma);
+  *stats = mma->stats;
+  heap_unlock(mma);
+  stats->free_blocks = MEMORY_FREE_BLOCKS(mma);
+#else
+  (void)mma;
+  stats->used_size = 0;
+  stats->free_size = 0;
+  stats->peak_size = 0;
+  stats->alloc_count = 0;
+  stats->free_count = 0;
+  stats->failed_count = 0;
+  stats->fl_count = 0;
+  stats->free_blocks = NULL;
+#endif /* MEMORY_STATS */
+}
+
+/******************************************************************************
+ * memory_heap_get_probes
+ * Get the probes of the block operations of a heap. Without MEMORY_PROBES all
+ * the probes are 0
+ *
+ * [in] mma     : heap
+ * [out] probes : probes
+ *****************************************************************************/
+void memory_heap_get_probes(memory_management_area_t * mma, memory_probes_t * probes)
+{
+#if MEMORY_PROBES
+  heap_lock(mma);
+  *probes = mma->probes;
+  heap_unlock(mma);
+#else
+  unsigned long index;
+
+  (void)mma;
+  for(index = 0; index < sizeof(memory_probes_t) / sizeof(unsigned long); index++)
+    ((unsigned long *)probes)[index] = 0;
+#endif /* MEMORY_PROBES */
+}
+
+/******************************************************************************
+ * memory_heap_reset_probes
+ * Reset the probes of a heap, to measure a phase of the program
+ *
+ * [in] mma : heap
+ *****************************************************************************/
+void memory_heap_reset_probes(memory_management_area_t * mma)
+{
+#if MEMORY_PROBES
+  unsigned long index;
+
+  heap_lock(mma);
+  for(index = 0; index < sizeof(memory_probes_t) / sizeof(unsigned long); index++)
+    ((unsigned long *)&mma->probes)[index] = 0;
+  heap_unlock(mma);
+#else
+  (void)mma;
+#endif /* MEMORY_PROBES */
+}
+
+/******************************************************************************
+ * memory_heap_coalesce
+ * Merge the blocks parked by the deferred coalescing of a heap
+ *
+ * [in] mma : heap
+ *
+ * Return the number of merged blocks (0 without MEMORY_DEFER)
+ *****************************************************************************/
+unsigned long memory_heap_coalesce(memory_management_area_t * mma)
+{
+  unsigned long count;
+
+  heap_lock(mma);
+  count = defer_flush(mma);
+  heap_unlock(mma);
+  return count;
+}
+
+/******************************************************************************
+ * memory_heap_set_defer_limit
+ * Set the number of blocks a heap can park. A free merges at most this
+ * number of blocks, 0 merges every block when it is freed
+ *
+ * [in] mma   : heap
+ * [in] limit : maximum number of parked blocks
+ *****************************************************************************/
+void memory_heap_set_defer_limit(memory_management_area_t * mma, unsigned long limit)
+{
+#if MEMORY_DEFER
+  heap_lock(mma);
+  if(mma->defer_count > limit)
+    defer_flush(mma);
+  mma->defer_limit = limit;
+  heap_unlock(mma);
+#else
+  (void)mma;
+  (void)limit;
+#endif /* MEMORY_DEFER */
+}
+
+/******************************************************************************
+ * memory_heap_set_fit_scan
+ * Set the number of blocks the good fit scans in the list of the wanted
+ * size, 0 searches from the next level only
+ *
+ * [in] mma  : heap
+ * [in] scan : maximum number of scanned blocks
+ *****************************************************************************/
+void memory_heap_set_fit_scan(memory_management_area_t * mma, unsigned long scan)
+{
+#if MEMORY_GOOD_FIT
+  heap_lock(mma);
+  mma->fit_scan = scan;
+  heap_unlock(mma);
+#else
+  (void)mma;
+  (void)scan;
+#endif /* MEMORY_GOOD_FIT */
+}
+
+/******************************************************************************
+ * pool_write_begin
+ * Start a change of the pool registry, the heap lock is taken. The sequence
+ * is odd until pool_write_end, memory_heap_owns reads the registry again
+ *
+ * [in] mma : heap
+ *****************************************************************************/
+static inline void pool_write_begin(memory_management_area_t * mma)
+{
+  __atomic_store_n(&mma->pool_seq, mma->pool_seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * pool_write_end
+ * Publish a change of the pool registry, the sequence is even again
+ *
+ * [in] mma : heap
+ *****************************************************************************/
+static inline void pool_write_end(memory_management_area_t * mma)
+{
+  __atomic_store_n(&mma->pool_seq, mma->pool_seq + 1, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * pool_write
+ * Set the memory range of a pool of the registry
+ *
+ * [in] mma   : heap
+ * [in] index : index of the pool
+ * [in] start : first address of the pool
+ * [in] end   : address after the pool
+ *****************************************************************************/
+static inline void pool_write(memory_management_area_t * mma, unsigned long index, unsigned long start, unsigned long end)
+{
+  __atomic_store_n(&mma->pools[index].start, start - (unsigned long)mma, __ATOMIC_RELAXED);
+  __atomic_store_n(&mma->pools[index].end, end - (unsigned long)mma, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * memory_heap_add_pool
+ * Add a memory area to a heap. The area becomes a free block of the heap,
+ * its first block has no physical previous block and its last block has the
+ * last bit, so blocks are never merged across two pools
+ *
+ * [in] mma     : heap
+ * [in] address : memory pointer
+ * [in] length  : size of the memory
+ *
+ * Return 1 if the pool is added, 0 if the registry is full, if the memory
+ * overlaps a pool, if its size needs more first levels than the heap has
+ * (see MEMORY_POOL_LIMIT) or if it is out of reach of the offset links
+ *****************************************************************************/
+unsigned long memory_heap_add_pool(memory_management_area_t * mma, void * address, unsigned long length)
+{
+  memory_block_t * block;
+  memory_level_t level;
+  unsigned long start;
+  unsigned long index;
+  unsigned long block_size;
+
+  /* Align like memory_heap_init */
+  if((unsigned long)address & ALIGN_MASK)
+  {
+    address = (void *)RESIZE_UP(address, LONG_SIZE_BYTE);
+    length -= LONG_SIZE_BYTE;
+  }
+  else
+  {
+    length = RESIZE_DOWN(length, LONG_SIZE_BYTE);
+  }
+
+  /* The chunk of the first block is aligned */
+  block = BLOCK_ALIGN_START(address);
+  if((unsigned long)block - (unsigned long)address > length)
+    return 0;
+  block_size = RESIZE_DOWN(length - ((unsigned long)block - (unsigned long)address), MEMORY_CHUNK_ALIGN);
+  if(block_size < BLOCK_MIN_SIZE)
+    return 0;
+
+  /* The biggest block of the pool must have its level in the heap */
+  block_get_levels(block_size - BLOCK_HEADER_SIZE_USED, &level);
+  if(level.fl >= mma->fl_count)
+    return 0;
+  if(!pool_in_reach(mma, address, length))
+    return 0;
+
+  start = (unsigned long)address;
+
+  heap_lock(mma);
+
+  if(mma->pool_count == MEMORY_POOL_MAX)
+  {
+    heap_unlock(mma);
+    return 0;
+  }
+  for(index = 0; index < mma->pool_count; index++)
+  {
+    if((start < (unsigned long)mma + mma->pools[index].end) && (start + length > (unsigned long)mma + mma->pools[index].start))
+    {
+      heap_unlock(mma);
+      return 0;
+    }
+  }
+
+  /* The whole pool is one free block */
+  block->size = block_size - BLOCK_HEADER_SIZE_USED;
+  block_set_physical_prev(mma, block, NULL);
+  BLOCK_MARK_AS_LAST(block);
+  block_insert(mma, block);
+
+  pool_write_begin(mma);
+  pool_write(mma, mma->pool_count, start, start + length);
+  __atomic_store_n(&mma->pool_count, mma->pool_count + 1, __ATOMIC_RELAXED);
+  pool_write_end(mma);
+
+  heap_unlock(mma);
+  return 1;
+}
+
+/******************************************************************************
+ * memory_heap_remove_pool
+ * Remove a pool added by memory_heap_add_pool. The pool must be entirely
+ * free, the first pool of the heap can not be removed
+ *
+ * [in] mma     : heap
+ * [in] address : memory pointer given to memory_heap_add_pool
+ *
+ * Return 1 if the pool is removed, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_heap_remove_pool(memory_management_area_t * mma, void * address)
+{
+  memory_block_t * block;
+  unsigned long start = RESIZE_UP(address, LONG_SIZE_BYTE);
+  unsigned long index;
+
+  heap_lock(mma);
+
+  for(index = 1; index < mma->pool_count; index++)
+  {
+    if((unsigned long)mma + mma->pools[index].start == start)
+      break;
+  }
+  if(index == mma->pool_count)
+  {
+    heap_unlock(mma);
+    return 0;
+  }
+
+  /* Entirely free means only one free block, once the parked blocks are merged */
+  defer_flush(mma);
+  block = BLOCK_ALIGN_START(start);
+  if(!BLOCK_IS_FREE(block) || !BLOCK_IS_LAST(block))
+  {
+    heap_unlock(mma);
+    return 0;
+  }
+  block_extract(mma, block);
+
+  pool_write_begin(mma);
+  __atomic_store_n(&mma->pool_count, mma->pool_count - 1, __ATOMIC_RELAXED);
+  pool_write(mma, index, (unsigned long)mma + mma->pools[mma->pool_count].start, (unsigned long)mma + mma->pools[mma->pool_count].end);
+  pool_write_end(mma);
+
+  heap_unlock(mma);
+  return 1;
+}
+
+/******************************************************************************
+ * memory_heap_owns
+ * Check if a memory is in one of the pools of a heap. The registry is read
+ * without the heap lock, the read is done again when other threads added or
+ * removed a pool meanwhile
+ *
+ * [in] mma : heap
+ * [in] ptr : pointer to check
+ *
+ * Return 1 if the memory is in the heap, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_heap_owns(memory_management_area_t * mma, void * ptr)
+{
+  unsigned long owned;
+  unsigned long count;
+  unsigned long index;
+  unsigned long seq;
+
+  do
+  {
+    /* An odd sequence is a change in progress */
+    while((seq = __atomic_load_n(&mma->pool_seq, __ATOMIC_ACQUIRE)) & 1);
+
+    owned = 0;
+    count = __atomic_load_n(&mma->pool_count, __ATOMIC_RELAXED);
+    for(index = 0; (index < count) && (index < MEMORY_POOL_MAX); index++)
+    {
+      if(((unsigned long)ptr >= (unsigned long)mma + __atomic_load_n(&mma->pools[index].start, __ATOMIC_RELAXED)) &&
+         ((unsigned long)ptr < (unsigned long)mma + __atomic_load_n(&mma->pools[index].end, __ATOMIC_RELAXED)))
+      {
+        owned = 1;
+        break;
+      }
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while(__atomic_load_n(&mma->pool_seq, __ATOMIC_RELAXED) != seq);
+
+  return owned;
+}
+
+/******************************************************************************
+ * memory_init
+ * Memory initialization of the default heap
+ *
+ * [in] mem_ptr : memory pointer
+ * [in] length  : size of the memory
+ *****************************************************************************/
+unsigned long memory_init(void * address, unsigned long length)
+{
+  mma = memory_heap_init(address, length);
+  return (mma != NULL) ? 1 : 0;
+}
+
+/******************************************************************************
+ * memory_alloc
+ * Memory allocation in the default heap
+ *
+ * [in] size : size of the memory to allocate (in byte)
+ *
+ * Return the pointer of the allocated size or null if error
+ *****************************************************************************/
+void * memory_alloc(unsigned long size)
+{
+  void * ptr = memory_heap_alloc(mma, size);
+
+  trace_record(MEMORY_TRACE_ALLOC, ptr, size);
+  return ptr;
+}
+
+/******************************************************************************
+ * memory_free
+ * Free a memory previously allocated in the default heap
+ *
+ * [in] ptr : pointer the memory to free
+ *****************************************************************************/
+void memory_free(void * ptr)
+{
+  /* Recorded before the free so a new allocation of the chunk comes after it */
+  if(ptr != NULL)
+    trace_record(MEMORY_TRACE_FREE, ptr, 0);
+  memory_heap_free(mma, ptr);
+}
+
+/******************************************************************************
+ * memory_alloc_batch
+ * Allocate several memories of the same size in the default heap
+ *
+ * [in] size  : size of each memory (in byte)
+ * [in] count : number of memories
+ * [out] out  : pointers of the allocated memories
+ *
+ * Return the number of allocated memories
+ *****************************************************************************/
+unsigned long memory_alloc_batch(unsigned long size, unsigned long count, void ** out)
+{
+  return memory_heap_alloc_batch(mma, size, count, out);
+}
+
+/******************************************************************************
+ * memory_free_batch
+ * Free several memories of the default heap
+ *
+ * [in] ptrs  : pointers the memories to free (sorted in place)
+ * [in] count : number of pointers
+ *****************************************************************************/
+void memory_free_batch(void ** ptrs, unsigned long count)
+{
+  memory_heap_free_batch(mma, ptrs, count);
+}
+
+/******************************************************************************
+ * memory_memalign
+ * Aligned memory allocation in the default heap
+ *
+ * [in] alignment : alignment of the memory (power of two)
+ * [in] size      : size of the memory to allocate (in byte)
+ *
+ * Return the aligned pointer of the allocated size or null if error
+ *****************************************************************************/
+void * memory_memalign(unsigned long alignment, unsigned long size)
+{
+  return memory_heap_memalign(mma, alignment, size);
+}
+
+/******************************************************************************
+ * memory_aligned_alloc
+ * Aligned memory allocation in the default heap, same as memory_memalign
+ *
+ * [in] alignment : alignment of the memory (power of two)
+ * [in] size      : size of the memory to allocate (in byte)
+ *
+ * Return the aligned pointer of the allocated size or null if error
+ *****************************************************************************/
+void * memory_aligned_alloc(unsigned long alignment, unsigned long size)
+{
+  return memory_heap_memalign(mma, alignment, size);
+}
+
+/******************************************************************************
+ * memory_realloc
+ * Change the size of an allocated memory in the default heap
+ *
+ * [in] ptr  : pointer the allocated memory (null to allocate)
+ * [in] size : new size of the memory (in byte, 0 to free)
+ *
+ * Return the pointer of the memory or null if error (the memory is unchanged)
+ *****************************************************************************/
+void * memory_realloc(void * ptr, unsigned long size)
+{
+  return memory_heap_realloc(mma, ptr, size);
+}
+
+/******************************************************************************
+ * memory_try_expand
+ * Resize an allocated memory of the default heap without moving it
+ *
+ * [in] ptr  : pointer the allocated memory
+ * [in] size : new size of the memory (in byte)
+ *
+ * Return 1 if the memory has now the new size, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_try_expand(void * ptr, unsigned long size)
+{
+  return memory_heap_try_expand(mma, ptr, size);
+}
+
+/******************************************************************************
+ * memory_get_lock_stats
+ * Get the lock contention counters of the default heap
+ *
+ * [out] stats : lock counters
+ *****************************************************************************/
+void memory_get_lock_stats(memory_lock_stats_t * stats)
+{
+  memory_heap_get_lock_stats(mma, stats);
+}
+
+/******************************************************************************
+ * memory_lock
+ * Hold the lock of the default heap
+ *****************************************************************************/
+void memory_lock(void)
+{
+  memory_heap_lock(mma);
+}
+
+/******************************************************************************
+ * memory_unlock
+ * Release the lock of the default heap
+ *****************************************************************************/
+void memory_unlock(void)
+{
+  memory_heap_unlock(mma);
+}
+
+/******************************************************************************
+ * memory_add_pool
+ * Add a memory area to the default heap
+ *
+ * [in] mem_ptr : memory pointer
+ * [in] length  : size of the memory
+ *
+ * Return 1 if the pool is added, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_add_pool(void * address, unsigned long length)
+{
+  return memory_heap_add_pool(mma, address, length);
+}
+
+/******************************************************************************
+ * memory_remove_pool
+ * Remove an entirely free pool of the default heap
+ *
+ * [in] mem_ptr : memory pointer given to memory_add_pool
+ *
+ * Return 1 if the pool is removed, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_remove_pool(void * address)
+{
+  return memory_heap_remove_pool(mma, address);
+}
+
+/******************************************************************************
+ * memory_owns
+ * Check if a memory is in the default heap
+ *
+ * [in] ptr : pointer to check
+ *
+ * Return 1 if the memory is in the heap, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_owns(void * ptr)
+{
+  return memory_heap_owns(mma, ptr);
+}
+
+/******************************************************************************
+ * memory_get_stats
+ * Get the allocation statistics of the default heap
+ *
+ * [out] stats : statistics
+ *****************************************************************************/
+void memory_get_stats(memory_stats_t * stats)
+{
+  memory_heap_get_stats(mma, stats);
+}
+
+/******************************************************************************
+ * memory_get_probes
+ * Get the probes of the block operations of the default heap
+ *
+ * [out] probes : probes
+ *****************************************************************************/
+void memory_get_probes(memory_probes_t * probes)
+{
+  memory_heap_get_probes(mma, probes);
+}
+
+/******************************************************************************
+ * memory_reset_probes
+ * Reset the probes of the default heap
+ *****************************************************************************/
+void memory_reset_probes(void)
+{
+  memory_heap_reset_probes(mma);
+}
+
+/******************************************************************************
+ * memory_coalesce
+ * Merge the blocks parked by the deferred coalescing of the default heap
+ *
+ * Return the number of merged blocks
+ *****************************************************************************/
+unsigned long memory_coalesce(void)
+{
+  return memory_heap_coalesce(mma);
+}
+
+/******************************************************************************
+ * memory_set_defer_limit
+ * Set the number of blocks the default heap can park
+ *
+ * [in] limit : maximum number of parked blocks
+ *****************************************************************************/
+void memory_set_defer_limit(unsigned long limit)
+{
+  memory_heap_set_defer_limit(mma, limit);
+}
+
+/******************************************************************************
+ * memory_set_fit_scan
+ * Set the number of blocks the good fit of the default heap scans
+ *
+ * [in] scan : maximum number of scanned blocks
+ *****************************************************************************/
+void memory_set_fit_scan(unsigned long scan)
+{
+  memory_heap_set_fit_scan(mma, scan);
+}
+
+/******************************************************************************
+ * memory_trace_start
+ * Start to record memory_alloc and memory_free in a trace file
+ *
+ * [in] path : trace file, replaced if it exists
+ *
+ * Return 1 if the trace is started, 0 if the file can not be opened
+ * or the trace is not built (MEMORY_TRACE)
+ *****************************************************************************/
+unsigned long memory_trace_start(const char * path)
+{
+#if MEMORY_TRACE
+  FILE * file;
+
+  memory_trace_stop();
+  file = fopen(path, "wb");
+  if(file == NULL)
+    return 0;
+
+  heap_lock(mma);
+  trace_count = 0;
+  trace_last_time = trace_get_time();
+  __atomic_store_n(&trace_file, file, __ATOMIC_RELAXED);
+  heap_unlock(mma);
+  return 1;
+#else
+  (void)path;
+  return 0;
+#endif /* MEMORY_TRACE */
+}
+
+/******************************************************************************
+ * memory_trace_stop
+ * Write the last records and close the trace file
+ *****************************************************************************/
+void memory_trace_stop(void)
+{
+#if MEMORY_TRACE
+  FILE * file;
+
+  if(__atomic_load_n(&trace_file, __ATOMIC_RELAXED) == NULL)
+    return;
+
+  heap_lock(mma);
+  file = trace_file;
+  if(file != NULL)
+  {
+    trace_flush();
+    __atomic_store_n(&trace_file, NULL, __ATOMIC_RELAXED);
+  }
+  heap_unlock(mma);
+  if(file != NULL)
+    fclose(file);
+#endif /* MEMORY_TRACE */
+}
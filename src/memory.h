@@ -23,26 +23,175 @@
 extern "C" {
 #endif
 
+#include <limits.h>
+
 #ifndef NULL
 #define NULL                                    (void*)(0)
 #endif /* NULL */
 
+/* Lock policy of a heap, select it with MEMORY_LOCK */
+#define MEMORY_LOCK_NONE                        0
+#define MEMORY_LOCK_SPIN                        1
+#define MEMORY_LOCK_MUTEX                       2
+
+#ifndef MEMORY_LOCK
+#define MEMORY_LOCK                             MEMORY_LOCK_NONE
+#endif /* MEMORY_LOCK */
+
+#if MEMORY_LOCK == MEMORY_LOCK_MUTEX
+#include <pthread.h>
+#endif /* MEMORY_LOCK */
+
+#ifndef offsetof
 #define offsetof(type,member)                   ((unsigned long) &(((type*)0)->member))
+#endif /* offsetof */
 
 #define LONG_SIZE_BYTE													sizeof(unsigned long)
 #define LONG_SIZE_BIT														(LONG_SIZE_BYTE * 8)
 #define ALIGN_MASK                              (LONG_SIZE_BYTE - 1)
 
+/* Block sizes are multiple of a word */
+#if ULONG_MAX > 0xFFFFFFFFUL
+#define MEMORY_ALIGN_LOG2                       3
+#else
+#define MEMORY_ALIGN_LOG2                       2
+#endif /* ULONG_MAX */
+
+/* Alignment of the chunks in bytes, a power of two from the word size. With
+   more than a word a block and its header take a multiple of the alignment
+   and the first block of a pool is placed so that its chunk is aligned, an
+   allocation needs no head split like memory_memalign does */
+#ifndef MEMORY_CHUNK_ALIGN
+#define MEMORY_CHUNK_ALIGN                      (1UL << MEMORY_ALIGN_LOG2)
+#endif /* MEMORY_CHUNK_ALIGN */
+
+#if (MEMORY_CHUNK_ALIGN < (1UL << MEMORY_ALIGN_LOG2)) || (MEMORY_CHUNK_ALIGN & (MEMORY_CHUNK_ALIGN - 1))
+#error "MEMORY_CHUNK_ALIGN must be a power of two from the word size"
+#endif /* MEMORY_CHUNK_ALIGN */
+
+/* Number of second levels per first level (log2), at most 5 for 32 bits
+   words and 6 for 64 bits words as a second level bitmap is a word */
+#ifndef MEMORY_SL_LOG2
+#define MEMORY_SL_LOG2                          5
+#endif /* MEMORY_SL_LOG2 */
+
+#if (MEMORY_SL_LOG2 < 1) || (MEMORY_SL_LOG2 > MEMORY_ALIGN_LOG2 + 3)
+#error "MEMORY_SL_LOG2 must be between 1 and the log2 of the word size in bits"
+#endif /* MEMORY_SL_LOG2 */
+
+#define MEMORY_SL_COUNT                         (1UL << MEMORY_SL_LOG2)
+
+/* Allocation statistics of the heaps, set MEMORY_STATS to 1 to keep them */
+#ifndef MEMORY_STATS
+#define MEMORY_STATS                            0
+#endif /* MEMORY_STATS */
+
+/* Probes of the internal block operations, set MEMORY_PROBES to 1 to keep them */
+#ifndef MEMORY_PROBES
+#define MEMORY_PROBES                           0
+#endif /* MEMORY_PROBES */
+
+/* Trace of memory_alloc and memory_free, set MEMORY_TRACE to 1 to record them */
+#ifndef MEMORY_TRACE
+#define MEMORY_TRACE                            0
+#endif /* MEMORY_TRACE */
+
+/* Number of trace records kept before writing them to the trace file */
+#ifndef MEMORY_TRACE_BUFFER
+#define MEMORY_TRACE_BUFFER                     4096
+#endif /* MEMORY_TRACE_BUFFER */
+
+/* Deferred coalescing, set MEMORY_DEFER to 1 to park the freed blocks up to
+   MEMORY_DEFER_MAX_SIZE bytes without merging them. A parked block is given
+   back as is to the next allocation of its size, the parked blocks are
+   merged when a search fails, when MEMORY_DEFER_BACKLOG blocks are parked
+   or by memory_heap_coalesce */
+#ifndef MEMORY_DEFER
+#define MEMORY_DEFER                            0
+#endif /* MEMORY_DEFER */
+
+#ifndef MEMORY_DEFER_MAX_SIZE
+#define MEMORY_DEFER_MAX_SIZE                   256
+#endif /* MEMORY_DEFER_MAX_SIZE */
+
+#ifndef MEMORY_DEFER_BACKLOG
+#define MEMORY_DEFER_BACKLOG                    64
+#endif /* MEMORY_DEFER_BACKLOG */
+
+/* Good fit, set MEMORY_GOOD_FIT to 1 to look for a big enough block in the
+   first MEMORY_GOOD_FIT_SCAN blocks of the list of the wanted size before
+   the search from the next level, which never takes a block of this list.
+   The number of scanned blocks can be changed at run time, 0 gives back the
+   next level search */
+#ifndef MEMORY_GOOD_FIT
+#define MEMORY_GOOD_FIT                         0
+#endif /* MEMORY_GOOD_FIT */
+
+#ifndef MEMORY_GOOD_FIT_SCAN
+#define MEMORY_GOOD_FIT_SCAN                    8
+#endif /* MEMORY_GOOD_FIT_SCAN */
+
+/* Address order, set MEMORY_ADDRESS_ORDER to 1 to keep each free list sorted
+   by address instead of last in first out. The allocations take the lowest
+   block of a list and the end of the pools stays in big free blocks, a free
+   walks the list of its size to insert the block */
+#ifndef MEMORY_ADDRESS_ORDER
+#define MEMORY_ADDRESS_ORDER                    0
+#endif /* MEMORY_ADDRESS_ORDER */
+
+/* Compact header, set MEMORY_COMPACT_HEADER to 1 to keep only the size in the
+   header of a used block. A free block ends with its own address and the
+   block after it has the BLOCK_PREV_FREE_BIT, the third flag bit needs sizes
+   multiple of 8 bytes so 64 bits words */
+#ifndef MEMORY_COMPACT_HEADER
+#define MEMORY_COMPACT_HEADER                   0
+#endif /* MEMORY_COMPACT_HEADER */
+
+#if MEMORY_COMPACT_HEADER && (MEMORY_ALIGN_LOG2 < 3)
+#error "MEMORY_COMPACT_HEADER needs 64 bits words"
+#endif /* MEMORY_COMPACT_HEADER */
+
+/* Offset links, set MEMORY_OFFSET_LINKS to 1 to keep the links of the blocks
+   and the heads of the free lists as signed 32 bits word offsets from the
+   heap control block. The size of a block is 32 bits too, so a block header
+   takes 16 bytes instead of 32. A pool must be smaller than 4 GiB and within
+   16 GiB of the control block */
+#ifndef MEMORY_OFFSET_LINKS
+#define MEMORY_OFFSET_LINKS                     0
+#endif /* MEMORY_OFFSET_LINKS */
+
+#if MEMORY_OFFSET_LINKS && (MEMORY_ALIGN_LOG2 < 3)
+#error "MEMORY_OFFSET_LINKS needs 64 bits words"
+#endif /* MEMORY_OFFSET_LINKS */
+
+#if MEMORY_OFFSET_LINKS && MEMORY_COMPACT_HEADER
+#error "MEMORY_OFFSET_LINKS and MEMORY_COMPACT_HEADER can not be used together"
+#endif /* MEMORY_OFFSET_LINKS */
+
+/* Maximum number of memory pools of a heap, the first one included */
+#ifndef MEMORY_POOL_MAX
+#define MEMORY_POOL_MAX                         8
+#endif /* MEMORY_POOL_MAX */
+
+/* Sizes under 1 << MEMORY_FL_SHIFT are in the first level 0, by step of a word */
+#define MEMORY_FL_SHIFT                         (MEMORY_SL_LOG2 + MEMORY_ALIGN_LOG2)
+
 #define RESIZE_UP(val, base)                    (((unsigned long)(val) + ((base)-1)) & ~((base)-1))
 #define RESIZE_DOWN(val, base)                  ((unsigned long)(val) & ~((base)-1))
 
 #define BLOCK_FREE_BIT		                      0x1UL
 #define BLOCK_LAST_BIT                         	0x2UL
-#define BLOCK_BIT_MASK                          (BLOCK_FREE_BIT | BLOCK_LAST_BIT)
+#if MEMORY_COMPACT_HEADER
+#define BLOCK_PREV_FREE_BIT                     0x4UL
+#else
+#define BLOCK_PREV_FREE_BIT                     0x0UL
+#endif /* MEMORY_COMPACT_HEADER */
+#define BLOCK_BIT_MASK                          (BLOCK_FREE_BIT | BLOCK_LAST_BIT | BLOCK_PREV_FREE_BIT)
 
 #define BLOCK_IS_FREE(block)                    ((block->size & BLOCK_FREE_BIT) ? 1 : 0)
 #define BLOCK_IS_USED(block)                    ((block->size & BLOCK_FREE_BIT) ? 0 : 1)
 #define BLOCK_IS_LAST(block)                    ((block->size & BLOCK_LAST_BIT) ? 1 : 0)
+#define BLOCK_IS_PREV_FREE(block)               ((block->size & BLOCK_PREV_FREE_BIT) ? 1 : 0)
 
 #define BLOCK_MARK_AS_LAST(block)              	((block)->size |= BLOCK_LAST_BIT)
 #define BLOCK_MARK_AS_NOT_LAST(block)           ((block)->size &= ~BLOCK_LAST_BIT)
@@ -51,25 +200,176 @@ extern "C" {
 
 #define BLOCK_GET_MASKED_SIZE(block)   					((block)->size & (~BLOCK_BIT_MASK))
 #define BLOCK_GET_FLAG_BIT(block)               ((block)->size & BLOCK_BIT_MASK)
+#define BLOCK_GET_PREV_FREE_BIT(block)          ((block)->size & BLOCK_PREV_FREE_BIT)
 #define BLOCK_MASK_FREE(level)                  (~((level)-1))
 
+/* A free block of the compact header also needs its last word for its address */
+#if MEMORY_COMPACT_HEADER
+#define BLOCK_MIN_SIZE				                  (sizeof(memory_block_t) + LONG_SIZE_BYTE)
+#else
 #define BLOCK_MIN_SIZE				                  sizeof(memory_block_t)
+#endif /* MEMORY_COMPACT_HEADER */
 #define BLOCK_HEADER_SIZE_FREE                  BLOCK_MIN_SIZE
 #define BLOCK_HEADER_SIZE_USED				          (unsigned long)offsetof(memory_block_t, prev)
 
+/* Size of the block of a chunk (at least BLOCK_MIN_SIZE bytes), the block and
+   its header take a multiple of MEMORY_CHUNK_ALIGN */
+#define BLOCK_ROUND_SIZE(size)                  (RESIZE_UP((unsigned long)(size) + BLOCK_HEADER_SIZE_USED, MEMORY_CHUNK_ALIGN) - BLOCK_HEADER_SIZE_USED)
+#define BLOCK_MIN_ALLOC_SIZE                    BLOCK_ROUND_SIZE(BLOCK_MIN_SIZE)
+
+/* First block of a memory area (aligned on a word), its chunk is aligned */
+#define BLOCK_ALIGN_START(address)              ((memory_block_t *)(RESIZE_UP((unsigned long)(address) + BLOCK_HEADER_SIZE_USED, MEMORY_CHUNK_ALIGN) - BLOCK_HEADER_SIZE_USED))
+
+/* Link to a block : its address, or its offset from the heap in words */
+#if MEMORY_OFFSET_LINKS
+typedef int memory_link_t;
+#define BLOCK_NO_LINK                           0
+#define BLOCK_TO_LINK(mma, block)               ((memory_link_t)(((long)(block) - (long)(mma)) >> MEMORY_ALIGN_LOG2))
+#define BLOCK_FROM_LINK(mma, link)              ((memory_block_t *)((long)(mma) + ((long)(link) << MEMORY_ALIGN_LOG2)))
+#define MEMORY_LINK_REACH                       (1UL << (31 + MEMORY_ALIGN_LOG2))
+#else
+typedef struct memory_block_s * memory_link_t;
+#define BLOCK_NO_LINK                           NULL
+#define BLOCK_TO_LINK(mma, block)               (block)
+#define BLOCK_FROM_LINK(mma, link)              (link)
+#endif /* MEMORY_OFFSET_LINKS */
+
+/* Previous link of a parked block, no block is at this address or offset */
+#define BLOCK_PARKED_LINK                       ((memory_link_t)1)
+
 typedef struct memory_block_s {
+#if MEMORY_OFFSET_LINKS
+  unsigned int size;
+#else
   unsigned long size;
-  struct memory_block_s *phys_prev;
-  struct memory_block_s *prev;
-  struct memory_block_s *next;
+#endif /* MEMORY_OFFSET_LINKS */
+#if !MEMORY_COMPACT_HEADER
+  memory_link_t phys_prev;
+#endif /* MEMORY_COMPACT_HEADER */
+  memory_link_t prev;
+  memory_link_t next;
 } memory_block_t;
 
+/* Lock contention counters */
+typedef struct {
+  unsigned long acquire_count;
+  unsigned long contended_count;
+  unsigned long spin_count;
+  unsigned long long wait_ns;
+} memory_lock_stats_t;
+
+/* Allocation statistics. free_blocks is the number of free blocks of each
+   level (free_blocks[fl * MEMORY_SL_COUNT + sl]), it is updated by the heap */
+typedef struct {
+  unsigned long used_size;
+  unsigned long free_size;
+  unsigned long peak_size;
+  unsigned long alloc_count;
+  unsigned long free_count;
+  unsigned long failed_count;
+  unsigned long fl_count;
+  unsigned long * free_blocks;
+} memory_stats_t;
+
+/* Calls and cycles of a block operation (nanoseconds when the CPU has no
+   cycle counter). The cycles of an operation include the operations it calls */
+typedef struct {
+  unsigned long long count;
+  unsigned long long cycles;
+} memory_probe_t;
+
+/* Probes of the block operations */
+typedef struct {
+  memory_probe_t find;
+  memory_probe_t insert;
+  memory_probe_t extract;
+  memory_probe_t split;
+  memory_probe_t merge_left;
+  memory_probe_t merge_right;
+  unsigned long find_escalated;
+  unsigned long find_failed;
+  unsigned long split_refused;
+  unsigned long coalesce_none;
+  unsigned long coalesce_left;
+  unsigned long coalesce_right;
+  unsigned long coalesce_both;
+  unsigned long fit_found;
+  unsigned long fit_missed;
+  unsigned long fit_scanned;
+} memory_probes_t;
+
+/* Operations of a trace record */
+#define MEMORY_TRACE_ALLOC                      0
+#define MEMORY_TRACE_FREE                       1
+
+/* Handle of a failed allocation */
+#define MEMORY_TRACE_NO_HANDLE                  0xFFFFFFFFU
+
+/* Record of a traced call. The handle is the offset of the chunk from the heap
+   control block in words, time_delta the nanoseconds since the previous record */
+typedef struct {
+  unsigned int op;
+  unsigned int handle;
+  unsigned int size;
+  unsigned int time_delta;
+} memory_trace_record_t;
+
+/* Number of parked block lists, one per size up to MEMORY_DEFER_MAX_SIZE */
+#define MEMORY_DEFER_CLASS_COUNT                ((MEMORY_DEFER_MAX_SIZE >> MEMORY_ALIGN_LOG2) + 1)
+
+/* Memory range of a pool, as offsets from the heap control block (modulo the
+   word size, a pool may be below the control block) */
+typedef struct {
+  unsigned long start;
+  unsigned long end;
+} memory_pool_t;
+
+/* Heap control block, placed at the start of the managed region and
+   followed by the second level bitmaps and the free block list array */
 typedef struct memory_management_area_s {
-  unsigned long * first_level;
-  unsigned long * second_level;
-  memory_block_t *(*fbla)[LONG_SIZE_BIT];
+  unsigned long first_level;
+  unsigned long fl_count;
+  unsigned long pool_seq;
+  unsigned long pool_count;
+  memory_pool_t pools[MEMORY_POOL_MAX];
+#if MEMORY_LOCK == MEMORY_LOCK_SPIN
+  unsigned long lock;
+#elif MEMORY_LOCK == MEMORY_LOCK_MUTEX
+  pthread_mutex_t lock;
+#endif /* MEMORY_LOCK */
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+  memory_lock_stats_t lock_stats;
+#endif /* MEMORY_LOCK */
+#if MEMORY_STATS
+  memory_stats_t stats;
+#endif /* MEMORY_STATS */
+#if MEMORY_PROBES
+  memory_probes_t probes;
+#endif /* MEMORY_PROBES */
+#if MEMORY_DEFER
+  unsigned long defer_count;
+  unsigned long defer_limit;
+  memory_link_t deferred[MEMORY_DEFER_CLASS_COUNT];
+#endif /* MEMORY_DEFER */
+#if MEMORY_GOOD_FIT
+  unsigned long fit_scan;
+#endif /* MEMORY_GOOD_FIT */
 } memory_management_area_t;
 
+/* The second level bitmaps, the free block list array and the free block
+   histogram (MEMORY_STATS) follow the control block. They are found from its
+   address and nothing in the heap holds an address with the offset links, so
+   such a heap can be moved or mapped at an other address when it has no
+   mutex lock */
+#define MEMORY_SECOND_LEVEL(mma)                ((unsigned long *)((unsigned long)(mma) + sizeof(memory_management_area_t)))
+#define MEMORY_FBLA(mma)                        ((memory_link_t (*)[MEMORY_SL_COUNT])(MEMORY_SECOND_LEVEL(mma) + (mma)->fl_count))
+#define MEMORY_FREE_BLOCKS(mma)                 ((unsigned long *)(MEMORY_FBLA(mma) + (mma)->fl_count))
+
+/* The first levels of a heap are sized for its first pool by memory_heap_init
+   and never grow, the free block of an added pool must be smaller than this
+   limit, the next power of two of the first pool size */
+#define MEMORY_POOL_LIMIT(mma)                  (1UL << ((mma)->fl_count + MEMORY_FL_SHIFT - 1))
+
 typedef struct {
   unsigned long fl;
   unsigned long fl_bitmap;
@@ -77,9 +377,60 @@ typedef struct {
   unsigned long sl_bitmap;
 } memory_level_t;
 
+/* Heap instance API */
+memory_management_area_t * memory_heap_init(void * mem_ptr, unsigned long length);
+void * memory_heap_alloc(memory_management_area_t * mma, unsigned long size);
+void * memory_heap_alloc_level(memory_management_area_t * mma, unsigned long size, const memory_level_t * level);
+void memory_heap_free(memory_management_area_t * mma, void * ptr);
+unsigned long memory_heap_alloc_batch(memory_management_area_t * mma, unsigned long size, unsigned long count, void ** out);
+void memory_heap_free_batch(memory_management_area_t * mma, void ** ptrs, unsigned long count);
+void * memory_heap_memalign(memory_management_area_t * mma, unsigned long alignment, unsigned long size);
+void * memory_heap_realloc(memory_management_area_t * mma, void * ptr, unsigned long size);
+unsigned long memory_heap_try_expand(memory_management_area_t * mma, void * ptr, unsigned long size);
+void memory_heap_get_lock_stats(memory_management_area_t * mma, memory_lock_stats_t * stats);
+void memory_heap_lock(memory_management_area_t * mma);
+void memory_heap_unlock(memory_management_area_t * mma);
+unsigned long memory_heap_add_pool(memory_management_area_t * mma, void * mem_ptr, unsigned long length);
+unsigned long memory_heap_remove_pool(memory_management_area_t * mma, void * mem_ptr);
+unsigned long memory_heap_owns(memory_management_area_t * mma, void * ptr);
+void memory_heap_get_stats(memory_management_area_t * mma, memory_stats_t * stats);
+void memory_heap_get_probes(memory_management_area_t * mma, memory_probes_t * probes);
+void memory_heap_reset_probes(memory_management_area_t * mma);
+unsigned long memory_heap_coalesce(memory_management_area_t * mma);
+void memory_heap_set_defer_limit(memory_management_area_t * mma, unsigned long limit);
+void memory_heap_set_fit_scan(memory_management_area_t * mma, unsigned long scan);
+unsigned long memory_usable_size(void * ptr);
+
+/* Default heap API */
 unsigned long memory_init(void * mem_ptr, unsigned long length);
 void * memory_alloc(unsigned long size);
 void memory_free(void * ptr);
+unsigned long memory_alloc_batch(unsigned long size, unsigned long count, void ** out);
+void memory_free_batch(void ** ptrs, unsigned long count);
+void * memory_memalign(unsigned long alignment, unsigned long size);
+void * memory_aligned_alloc(unsigned long alignment, unsigned long size);
+void * memory_realloc(void * ptr, unsigned long size);
+unsigned long memory_try_expand(void * ptr, unsigned long size);
+void memory_get_lock_stats(memory_lock_stats_t * stats);
+void memory_lock(void);
+void memory_unlock(void);
+unsigned long memory_add_pool(void * mem_ptr, unsigned long length);
+unsigned long memory_remove_pool(void * mem_ptr);
+unsigned long memory_owns(void * ptr);
+void memory_get_stats(memory_stats_t * stats);
+void memory_get_probes(memory_probes_t * probes);
+void memory_reset_probes(void);
+unsigned long memory_coalesce(void);
+void memory_set_defer_limit(unsigned long limit);
+void memory_set_fit_scan(unsigned long scan);
+unsigned long memory_trace_start(const char * path);
+void memory_trace_stop(void);
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_THREADS__)
+#define MEMORY_THREAD_LOCAL                     _Thread_local
+#else
+#define MEMORY_THREAD_LOCAL                     __thread
+#endif
 
 #ifdef TEST_MODE
 #define STATIC
@@ -0,0 +1,304 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pthread.h>
+#include "memory_cache.h"
+
+/* Cache of the current thread */
+STATIC MEMORY_THREAD_LOCAL memory_cache_t thread_cache;
+
+/* Key whose destructor flushes the cache of an exiting thread */
+STATIC pthread_key_t cache_key;
+STATIC pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+/******************************************************************************
+ * cache_get_class
+ * Get the size class of the block the heap gives for a size
+ *
+ * [in] size : wanted size
+ *
+ * Return the size class
+ *****************************************************************************/
+static inline unsigned long cache_get_class(unsigned long size)
+{
+  if(size < BLOCK_MIN_SIZE)
+    size = BLOCK_MIN_SIZE;
+  return BLOCK_ROUND_SIZE(size) / LONG_SIZE_BYTE;
+}
+
+/******************************************************************************
+ * cache_push
+ * Push a block on the list of its size class and mark it as cached
+ *
+ * [in] cc  : size class of the block
+ * [in] ptr : block
+ *****************************************************************************/
+static inline void cache_push(memory_cache_class_t * cc, void * ptr)
+{
+  ((void **)ptr)[0] = cc->head;
+  ((unsigned long *)ptr)[1] = (unsigned long)ptr ^ MEMORY_CACHE_COOKIE;
+  cc->head = ptr;
+  cc->count++;
+}
+
+/******************************************************************************
+ * cache_is_cached
+ * Tell if a block is in the list of a size class
+ *
+ * [in] cc  : size class of the block
+ * [in] ptr : block
+ *
+ * Return 1 if the block is in the list
+ *****************************************************************************/
+static inline unsigned long cache_is_cached(memory_cache_class_t * cc, void * ptr)
+{
+  void * cached;
+
+  /* The mark only avoids walking the list for most of the blocks */
+  if(((unsigned long *)ptr)[1] != ((unsigned long)ptr ^ MEMORY_CACHE_COOKIE))
+    return 0;
+  for(cached = cc->head; cached != NULL; cached = *(void **)cached)
+    if(cached == ptr)
+      return 1;
+  return 0;
+}
+
+/******************************************************************************
+ * cache_release
+ * Give back blocks of a size class to the heap
+ *
+ * [in] cache : cache of the current thread
+ * [in] class : size class
+ * [in] count : number of blocks to give back
+ *****************************************************************************/
+STATIC void cache_release(memory_cache_t * cache, unsigned long class, unsigned long count)
+{
+  memory_cache_class_t * cc = &cache->classes[class];
+  void * batch[MEMORY_CACHE_BATCH];
+  unsigned long index;
+
+  while((count > 0) && (cc->head != NULL))
+  {
+    for(index = 0; (index < count) && (index < MEMORY_CACHE_BATCH) && (cc->head != NULL); index++)
+    {
+      batch[index] = cc->head;
+      cc->head = *(void **)batch[index];
+      cc->count--;
+      cache->bytes -= memory_usable_size(batch[index]);
+    }
+    count -= index;
+
+    /* Adjacent blocks are merged before going back to the free lists */
+    memory_heap_free_batch(cache->heap, batch, index);
+  }
+}
+
+/******************************************************************************
+ * cache_refill
+ * Get a batch of blocks of a size class from the heap
+ *
+ * [in] cache : cache of the current thread
+ * [in] class : size class
+ *
+ * Return a block of the size class or null if the heap is full
+ *****************************************************************************/
+STATIC void * cache_refill(memory_cache_t * cache, unsigned long class)
+{
+  memory_cache_class_t * cc = &cache->classes[class];
+  void * batch[MEMORY_CACHE_BATCH];
+  unsigned long count = MEMORY_CACHE_BATCH;
+  unsigned long index;
+
+  /* The class is empty, keep the cache under its limits */
+  if(count > MEMORY_CACHE_CLASS_LIMIT + 1)
+    count = MEMORY_CACHE_CLASS_LIMIT + 1;
+  if(cache->bytes >= MEMORY_CACHE_BYTES_LIMIT)
+    count = 1;
+  else if(count > (MEMORY_CACHE_BYTES_LIMIT - cache->bytes) / (class * LONG_SIZE_BYTE) + 1)
+    count = (MEMORY_CACHE_BYTES_LIMIT - cache->bytes) / (class * LONG_SIZE_BYTE) + 1;
+
+  /* The blocks of the batch are cut from one free block */
+  count = memory_heap_alloc_batch(cache->heap, class * LONG_SIZE_BYTE, count, batch);
+  if(count == 0)
+    return NULL;
+
+  /* Keep the others blocks of the batch in the cache */
+  for(index = 1; index < count; index++)
+  {
+    cache_push(cc, batch[index]);
+    cache->bytes += memory_usable_size(batch[index]);
+  }
+  return batch[0];
+}
+
+/******************************************************************************
+ * cache_flush
+ * Give back all the blocks of a cache to its heap
+ *
+ * [in] cache : cache of a thread
+ *****************************************************************************/
+STATIC void cache_flush(memory_cache_t * cache)
+{
+  unsigned long class;
+
+  if(cache->heap == NULL)
+    return;
+
+  for(class = 0; class < MEMORY_CACHE_CLASS_COUNT; class++)
+    cache_release(cache, class, cache->classes[class].count);
+
+  /* The cache can be used now with another heap */
+  cache->heap = NULL;
+}
+
+/******************************************************************************
+ * cache_thread_exit
+ * Destructor of the cache key, called when a thread using a cache exits
+ *
+ * [in] cache : cache of the exiting thread
+ *****************************************************************************/
+STATIC void cache_thread_exit(void * cache)
+{
+  cache_flush((memory_cache_t *)cache);
+}
+
+/******************************************************************************
+ * cache_key_create
+ * Create the key of the caches, once for all the threads
+ *****************************************************************************/
+STATIC void cache_key_create(void)
+{
+  pthread_key_create(&cache_key, cache_thread_exit);
+}
+
+/******************************************************************************
+ * cache_attach
+ * Bind the empty cache of the current thread to a heap, the cache is flushed
+ * when the thread exits
+ *
+ * [in] cache : cache of the current thread
+ * [in] mma   : heap
+ *****************************************************************************/
+STATIC void cache_attach(memory_cache_t * cache, memory_management_area_t * mma)
+{
+  pthread_once(&cache_key_once, cache_key_create);
+  pthread_setspecific(cache_key, cache);
+  cache->heap = mma;
+}
+
+/******************************************************************************
+ * memory_cache_alloc
+ * Memory allocation through the cache of the current thread
+ *
+ * [in] mma  : heap
+ * [in] size : size of the memory to allocate (in byte)
+ *
+ * Return the pointer of the allocated size or null if error
+ *****************************************************************************/
+void * memory_cache_alloc(memory_management_area_t * mma, unsigned long size)
+{
+  memory_cache_t * cache = &thread_cache;
+  memory_cache_class_t * cc;
+  unsigned long class;
+  void * ptr;
+
+  /* Big sizes and others heaps go to the heap */
+  if(size > MEMORY_CACHE_MAX_SIZE)
+    return memory_heap_alloc(mma, size);
+  if(cache->heap != mma)
+  {
+    if(cache->heap != NULL)
+      return memory_heap_alloc(mma, size);
+    cache_attach(cache, mma);
+  }
+
+  class = cache_get_class(size);
+  cc = &cache->classes[class];
+  if(cc->head == NULL)
+    return cache_refill(cache, class);
+
+  /* Pop the last freed block */
+  ptr = cc->head;
+  cc->head = *(void **)ptr;
+  ((unsigned long *)ptr)[1] = 0;
+  cc->count--;
+  cache->bytes -= memory_usable_size(ptr);
+  return ptr;
+}
+
+/******************************************************************************
+ * memory_cache_free
+ * Free a memory through the cache of the current thread, a memory already
+ * free in the cache or in the heap is ignored like in memory_heap_free
+ *
+ * [in] mma : heap
+ * [in] ptr : pointer the memory to free
+ *****************************************************************************/
+void memory_cache_free(memory_management_area_t * mma, void * ptr)
+{
+  memory_cache_t * cache = &thread_cache;
+  memory_cache_class_t * cc;
+  unsigned long size = memory_usable_size(ptr);
+  unsigned long class;
+
+  /* Big blocks and others heaps go to the heap */
+  if((size > BLOCK_ROUND_SIZE(MEMORY_CACHE_MAX_SIZE)) || ((cache->heap != mma) && (cache->heap != NULL)))
+  {
+    memory_heap_free(mma, ptr);
+    return;
+  }
+  if(cache->heap == NULL)
+    cache_attach(cache, mma);
+
+  /* A block of the class is at least as big as the class size */
+  class = size / LONG_SIZE_BYTE;
+  cc = &cache->classes[class];
+
+  /* Double free of a block kept by the cache or given back to the heap */
+  if(cache_is_cached(cc, ptr) || BLOCK_IS_FREE(((memory_block_t *)((unsigned long)ptr - BLOCK_HEADER_SIZE_USED))))
+    return;
+
+  /* Push the block */
+  cache_push(cc, ptr);
+  cache->bytes += size;
+
+  /* Give back a batch to the heap if the cache is too big */
+  if((cc->count > MEMORY_CACHE_CLASS_LIMIT) || (cache->bytes > MEMORY_CACHE_BYTES_LIMIT))
+    cache_release(cache, class, MEMORY_CACHE_BATCH);
+}
+
+/******************************************************************************
+ * memory_cache_flush
+ * Give back all the blocks of the cache of the current thread to the heap,
+ * it is done anyway when the thread exits
+ *****************************************************************************/
+void memory_cache_flush(void)
+{
+  cache_flush(&thread_cache);
+}
+
+/******************************************************************************
+ * memory_cache_get_bytes
+ * Get the number of bytes kept by the cache of the current thread
+ *
+ * Return the number of bytes
+ *****************************************************************************/
+unsigned long memory_cache_get_bytes(void)
+{
+  return thread_cache.bytes;
+}
@@ -0,0 +1,76 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORY_CACHE_H
+#define MEMORY_CACHE_H
+
+#include "memory.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Biggest size served by the cache */
+#ifndef MEMORY_CACHE_MAX_SIZE
+#define MEMORY_CACHE_MAX_SIZE                   256
+#endif /* MEMORY_CACHE_MAX_SIZE */
+
+/* Maximum number of blocks in one size class */
+#ifndef MEMORY_CACHE_CLASS_LIMIT
+#define MEMORY_CACHE_CLASS_LIMIT                64
+#endif /* MEMORY_CACHE_CLASS_LIMIT */
+
+/* Maximum number of bytes kept by the cache of one thread */
+#ifndef MEMORY_CACHE_BYTES_LIMIT
+#define MEMORY_CACHE_BYTES_LIMIT                (64 * 1024)
+#endif /* MEMORY_CACHE_BYTES_LIMIT */
+
+/* Number of blocks moved at once between the cache and the heap */
+#ifndef MEMORY_CACHE_BATCH
+#define MEMORY_CACHE_BATCH                      16
+#endif /* MEMORY_CACHE_BATCH */
+
+/* The classes are the usable sizes the heap gives in words, up to the rounding of MEMORY_CACHE_MAX_SIZE */
+#define MEMORY_CACHE_CLASS_COUNT                ((MEMORY_CACHE_MAX_SIZE + MEMORY_CHUNK_ALIGN) / LONG_SIZE_BYTE + 1)
+
+/* Mark of a cached block in its second word, the block address xor this value */
+#define MEMORY_CACHE_COOKIE                     0x5CAC4E5AUL
+
+/* Blocks of one size class, linked by their first word and marked by their second word */
+typedef struct {
+  void * head;
+  unsigned long count;
+} memory_cache_class_t;
+
+/* Cache of one thread */
+typedef struct {
+  memory_management_area_t * heap;
+  unsigned long bytes;
+  memory_cache_class_t classes[MEMORY_CACHE_CLASS_COUNT];
+} memory_cache_t;
+
+void * memory_cache_alloc(memory_management_area_t * mma, unsigned long size);
+void memory_cache_free(memory_management_area_t * mma, void * ptr);
+void memory_cache_flush(void);
+unsigned long memory_cache_get_bytes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMORY_CACHE_H */
@@ -0,0 +1,335 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Pools reserved with mmap instead of a buffer given by the caller. With
+   MEMORY_OS_PAGES_TRANSPARENT the pool is aligned on a huge page and the
+   kernel is asked to back it with transparent huge pages, with
+   MEMORY_OS_PAGES_EXPLICIT it is taken from the huge page pool of the system
+   (vm.nr_hugepages). A big heap then walks its free lists and coalesces its
+   blocks with far less TLB misses. A policy which cannot be obtained falls
+   back to the next one, down to normal pages, the pool tells which one it
+   got. The first prefault bytes of the pool (control area and first blocks)
+   can be touched at once, the other pages are given by the system when they
+   are first touched. */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "bitwise.h"
+#include "memory_os.h"
+
+/* Mode of the transparent huge pages, madvise succeeds even when it is never */
+#define OS_TRANSPARENT_ENABLED                  "/sys/kernel/mm/transparent_hugepage/enabled"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS                           MAP_ANON
+#endif /* MAP_ANONYMOUS */
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE                           0
+#endif /* MAP_NORESERVE */
+
+/******************************************************************************
+ * os_page_size
+ * Get the size of a normal page
+ *
+ * Return the page size
+ *****************************************************************************/
+STATIC unsigned long os_page_size(void)
+{
+  long page = sysconf(_SC_PAGESIZE);
+
+  return (page > 0) ? (unsigned long)page : 4096UL;
+}
+
+/******************************************************************************
+ * os_map
+ * Map anonymous memory, its pages are given when they are touched
+ *
+ * [in] length : size of the mapping
+ * [in] flags  : additional mmap flags
+ *
+ * Return the mapping or null if the system refuses
+ *****************************************************************************/
+STATIC void * os_map(unsigned long length, int flags)
+{
+  void * address = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+
+  return (address == MAP_FAILED) ? NULL : address;
+}
+
+/******************************************************************************
+ * os_reserve_explicit
+ * Reserve a pool in the huge page pool of the system. The pages are reserved
+ * by mmap, so a pool too big for the huge page pool is refused here rather
+ * than faulting later
+ *
+ * [out] pool   : pool reserved
+ * [in]  length : size of the pool
+ *
+ * Return 1 if the pool is reserved, 0 otherwise
+ *****************************************************************************/
+STATIC unsigned long os_reserve_explicit(memory_os_pool_t * pool, unsigned long length)
+{
+#ifdef MAP_HUGETLB
+  int flags = MAP_HUGETLB;
+
+  length = RESIZE_UP(length, MEMORY_OS_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGE_SHIFT
+  flags |= (int)(bit_highest_pos(MEMORY_OS_HUGE_PAGE_SIZE) << MAP_HUGE_SHIFT);
+#endif /* MAP_HUGE_SHIFT */
+  pool->address = os_map(length, flags);
+  if(pool->address == NULL)
+    return 0;
+  pool->length = length;
+  pool->pages = MEMORY_OS_PAGES_EXPLICIT;
+  return 1;
+#else
+  (void)pool;
+  (void)length;
+  return 0;
+#endif /* MAP_HUGETLB */
+}
+
+/******************************************************************************
+ * os_transparent_enabled
+ * Check that the system gives transparent huge pages to the areas advised
+ * for them. The mode in use is between brackets (always [madvise] never),
+ * read without allocating memory
+ *
+ * [in] path : file of the transparent huge page mode
+ *
+ * Return 1 if the mode is always or madvise, 0 if it is never or unknown
+ *****************************************************************************/
+STATIC unsigned long os_transparent_enabled(const char * path)
+{
+  char text[128];
+  ssize_t length;
+  int file;
+
+  file = open(path, O_RDONLY);
+  if(file < 0)
+    return 0;
+  length = read(file, text, sizeof(text) - 1);
+  close(file);
+  if(length <= 0)
+    return 0;
+  text[length] = 0;
+  return ((strstr(text, "[always]") != NULL) || (strstr(text, "[madvise]") != NULL)) ? 1 : 0;
+}
+
+/******************************************************************************
+ * os_reserve_transparent
+ * Reserve a pool aligned on a huge page and ask for transparent huge pages.
+ * The mapping is over sized by a huge page, its unaligned head and tail are
+ * given back. The pool has normal pages when the system mode is never
+ *
+ * [out] pool   : pool reserved
+ * [in]  length : size of the pool
+ * [in]  page   : size of a normal page
+ *
+ * Return 1 if the pool is reserved, 0 otherwise
+ *****************************************************************************/
+STATIC unsigned long os_reserve_transparent(memory_os_pool_t * pool, unsigned long length, unsigned long page)
+{
+  unsigned long span;
+  unsigned long start;
+  unsigned long aligned;
+  char * address;
+
+  length = RESIZE_UP(length, MEMORY_OS_HUGE_PAGE_SIZE);
+  span = length + MEMORY_OS_HUGE_PAGE_SIZE - page;
+  if(span < length)
+    return 0;
+  address = (char *)os_map(span, MAP_NORESERVE);
+  if(address == NULL)
+    return 0;
+
+  start = (unsigned long)address;
+  aligned = RESIZE_UP(start, MEMORY_OS_HUGE_PAGE_SIZE);
+  if(aligned != start)
+    munmap(address, aligned - start);
+  if(aligned + length != start + span)
+    munmap((void *)(aligned + length), start + span - (aligned + length));
+
+  pool->address = (void *)aligned;
+  pool->length = length;
+  pool->pages = MEMORY_OS_PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+  if(os_transparent_enabled(OS_TRANSPARENT_ENABLED) && (madvise(pool->address, length, MADV_HUGEPAGE) == 0))
+    pool->pages = MEMORY_OS_PAGES_TRANSPARENT;
+#endif /* MADV_HUGEPAGE */
+  return 1;
+}
+
+/******************************************************************************
+ * os_prefault
+ * Give at once the pages of the start of a pool
+ *
+ * [in] pool   : pool reserved
+ * [in] length : size to prefault
+ * [in] page   : size of a normal page
+ *****************************************************************************/
+STATIC void os_prefault(memory_os_pool_t * pool, unsigned long length, unsigned long page)
+{
+  volatile char * address = (volatile char *)pool->address;
+  unsigned long offset;
+
+  if(length > pool->length)
+    length = pool->length;
+  length = RESIZE_UP(length, page);
+  if(length == 0)
+    return;
+#ifdef MADV_POPULATE_WRITE
+  if(madvise(pool->address, length, MADV_POPULATE_WRITE) == 0)
+    return;
+#endif /* MADV_POPULATE_WRITE */
+  /* The pool is new, its pages are zero */
+  for(offset = 0; offset < length; offset += page)
+    address[offset] = 0;
+}
+
+/******************************************************************************
+ * memory_os_reserve
+ * Reserve a pool from the system
+ *
+ * [out] pool     : pool reserved, its length is the one asked rounded up to
+ *                  a page (a huge page for the huge page policies)
+ * [in]  length   : size of the pool
+ * [in]  pages    : page policy wanted, MEMORY_OS_PAGES_xxx
+ * [in]  prefault : size of the start of the pool whose pages are given at
+ *                  once, 0 for none
+ *
+ * Return 1 if the pool is reserved, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_os_reserve(memory_os_pool_t * pool, unsigned long length, unsigned long pages, unsigned long prefault)
+{
+  unsigned long page = os_page_size();
+  unsigned long reserved = 0;
+
+  pool->address = NULL;
+  pool->length = 0;
+  pool->pages = MEMORY_OS_PAGES_NORMAL;
+  if((length == 0) || (length > ULONG_MAX - MEMORY_OS_HUGE_PAGE_SIZE))
+    return 0;
+
+  if(pages == MEMORY_OS_PAGES_EXPLICIT)
+    reserved = os_reserve_explicit(pool, length);
+  if((reserved == 0) && (pages != MEMORY_OS_PAGES_NORMAL))
+    reserved = os_reserve_transparent(pool, length, page);
+  if(reserved == 0)
+  {
+    length = RESIZE_UP(length, page);
+    pool->address = os_map(length, MAP_NORESERVE);
+    if(pool->address == NULL)
+      return 0;
+    pool->length = length;
+  }
+
+  os_prefault(pool, prefault, page);
+  return 1;
+}
+
+/******************************************************************************
+ * memory_os_release
+ * Give a pool back to the system, no heap may use it anymore
+ *
+ * [in] pool : pool reserved by memory_os_reserve
+ *****************************************************************************/
+void memory_os_release(memory_os_pool_t * pool)
+{
+  if(pool->address != NULL)
+    munmap(pool->address, pool->length);
+  pool->address = NULL;
+  pool->length = 0;
+}
+
+/******************************************************************************
+ * memory_os_heap_init
+ * Reserve a pool from the system and initialize a heap in it
+ *
+ * [out] pool     : pool reserved
+ * [in]  length   : size of the pool
+ * [in]  pages    : page policy wanted, MEMORY_OS_PAGES_xxx
+ * [in]  prefault : size of the start of the pool whose pages are given at
+ *                  once, 0 for none
+ *
+ * Return the heap or null if the pool cannot be reserved or used
+ *****************************************************************************/
+memory_management_area_t * memory_os_heap_init(memory_os_pool_t * pool, unsigned long length, unsigned long pages, unsigned long prefault)
+{
+  memory_management_area_t * mma;
+
+  if(memory_os_reserve(pool, length, pages, prefault) == 0)
+    return NULL;
+  mma = memory_heap_init(pool->address, pool->length);
+  if(mma == NULL)
+    memory_os_release(pool);
+  return mma;
+}
+
+/******************************************************************************
+ * memory_os_add_pool
+ * Reserve a pool from the system and add it to a heap
+ *
+ * [in]  mma      : memory management area
+ * [out] pool     : pool reserved
+ * [in]  length   : size of the pool
+ * [in]  pages    : page policy wanted, MEMORY_OS_PAGES_xxx
+ * [in]  prefault : size of the start of the pool whose pages are given at
+ *                  once, 0 for none
+ *
+ * Return 1 if the pool is added, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_os_add_pool(memory_management_area_t * mma, memory_os_pool_t * pool, unsigned long length, unsigned long pages, unsigned long prefault)
+{
+  if(memory_os_reserve(pool, length, pages, prefault) == 0)
+    return 0;
+  if(memory_heap_add_pool(mma, pool->address, pool->length) == 0)
+  {
+    memory_os_release(pool);
+    return 0;
+  }
+  return 1;
+}
+
+/******************************************************************************
+ * memory_os_init
+ * Reserve a pool from the system and initialize the default heap in it
+ *
+ * [out] pool     : pool reserved
+ * [in]  length   : size of the pool
+ * [in]  pages    : page policy wanted, MEMORY_OS_PAGES_xxx
+ * [in]  prefault : size of the start of the pool whose pages are given at
+ *                  once, 0 for none
+ *
+ * Return 1 if the default heap is initialized, 0 otherwise
+ *****************************************************************************/
+unsigned long memory_os_init(memory_os_pool_t * pool, unsigned long length, unsigned long pages, unsigned long prefault)
+{
+  if(memory_os_reserve(pool, length, pages, prefault) == 0)
+    return 0;
+  if(memory_init(pool->address, pool->length) == 0)
+  {
+    memory_os_release(pool);
+    return 0;
+  }
+  return 1;
+}
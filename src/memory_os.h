@@ -0,0 +1,59 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORY_OS_H
+#define MEMORY_OS_H
+
+#include "memory.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pages of a pool reserved from the system */
+#define MEMORY_OS_PAGES_NORMAL                  0
+#define MEMORY_OS_PAGES_TRANSPARENT             1
+#define MEMORY_OS_PAGES_EXPLICIT                2
+
+/* Size of a huge page, a huge page pool is aligned and sized on it */
+#ifndef MEMORY_OS_HUGE_PAGE_SIZE
+#define MEMORY_OS_HUGE_PAGE_SIZE                (2UL << 20)
+#endif /* MEMORY_OS_HUGE_PAGE_SIZE */
+
+/* Pool reserved from the system. pages is the page policy obtained, an
+   explicit huge page pool falls back to transparent huge pages, and these
+   to normal pages, when the system has none (transparent huge page mode
+   never). Transparent huge pages are given by the kernel when it can, the
+   pool may still have some normal pages */
+typedef struct {
+  void * address;
+  unsigned long length;
+  unsigned long pages;
+} memory_os_pool_t;
+
+unsigned long memory_os_reserve(memory_os_pool_t * pool, unsigned long length, unsigned long pages, unsigned long prefault);
+void memory_os_release(memory_os_pool_t * pool);
+memory_management_area_t * memory_os_heap_init(memory_os_pool_t * pool, unsigned long length, unsigned long pages, unsigned long prefault);
+unsigned long memory_os_add_pool(memory_management_area_t * mma, memory_os_pool_t * pool, unsigned long length, unsigned long pages, unsigned long prefault);
+unsigned long memory_os_init(memory_os_pool_t * pool, unsigned long length, unsigned long pages, unsigned long prefault);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMORY_OS_H */
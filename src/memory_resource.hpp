@@ -0,0 +1,151 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* C++ adapters of the memory.c heaps for the standard containers.
+   Allocator<T> is an allocator of the standard library on a heap, a default
+   constructed one uses the default heap (memory_alloc) and all of them are
+   equal, an other heap makes it stateful. HeapResource is the same for the
+   polymorphic allocators (C++17), two resources are equal when they use the
+   same heap. The size given back to a deallocation is not needed, a block
+   knows its size, and an aligned block is freed like the others. */
+
+#ifndef MEMORY_RESOURCE_HPP
+#define MEMORY_RESOURCE_HPP
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
+#include "memory.h"
+
+namespace fma32 {
+
+namespace detail {
+
+/* Allocate in a heap, the default heap if it is null */
+inline void * HeapAllocate(memory_management_area_t * heap, std::size_t bytes, std::size_t alignment)
+{
+  void * ptr;
+
+  if(heap == nullptr)
+    ptr = memory_memalign(alignment, bytes);
+  else
+    ptr = memory_heap_memalign(heap, alignment, bytes);
+  if(ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+/* Free in a heap, the default heap if it is null */
+inline void HeapDeallocate(memory_management_area_t * heap, void * ptr)
+{
+  if(heap == nullptr)
+    memory_free(ptr);
+  else
+    memory_heap_free(heap, ptr);
+}
+
+} // namespace detail
+
+/* Allocator of the standard containers on a heap */
+template<typename T>
+class Allocator {
+  public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    /* The default heap */
+    Allocator(void) noexcept : m_heap(nullptr) {}
+    /* A heap of memory_heap_init */
+    explicit Allocator(memory_management_area_t * heap) noexcept : m_heap(heap) {}
+    template<typename U>
+    Allocator(const Allocator<U> & other) noexcept : m_heap(other.GetHeap()) {}
+
+    T * allocate(std::size_t count)
+    {
+      if(count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+        throw std::bad_array_new_length();
+      return static_cast<T *>(detail::HeapAllocate(m_heap, count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T * ptr, std::size_t) noexcept
+    {
+      detail::HeapDeallocate(m_heap, ptr);
+    }
+
+    /* Null for the default heap */
+    memory_management_area_t * GetHeap(void) const noexcept {return m_heap;}
+
+  private:
+    memory_management_area_t * m_heap;
+};
+
+template<typename T, typename U>
+inline bool operator==(const Allocator<T> & left, const Allocator<U> & right) noexcept
+{
+  return left.GetHeap() == right.GetHeap();
+}
+
+template<typename T, typename U>
+inline bool operator!=(const Allocator<T> & left, const Allocator<U> & right) noexcept
+{
+  return left.GetHeap() != right.GetHeap();
+}
+
+#if __cplusplus >= 201703L
+/* Memory resource of the polymorphic allocators on a heap */
+class HeapResource : public std::pmr::memory_resource {
+  public:
+    /* The default heap */
+    HeapResource(void) noexcept : m_heap(nullptr) {}
+    /* A heap of memory_heap_init */
+    explicit HeapResource(memory_management_area_t * heap) noexcept : m_heap(heap) {}
+
+    /* Null for the default heap */
+    memory_management_area_t * GetHeap(void) const noexcept {return m_heap;}
+
+  protected:
+    void * do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+      return detail::HeapAllocate(m_heap, bytes, alignment);
+    }
+
+    void do_deallocate(void * ptr, std::size_t, std::size_t) override
+    {
+      detail::HeapDeallocate(m_heap, ptr);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override
+    {
+      const HeapResource * resource = dynamic_cast<const HeapResource *>(&other);
+      return (resource != nullptr) && (resource->m_heap == m_heap);
+    }
+
+  private:
+    memory_management_area_t * m_heap;
+};
+#endif
+
+} // namespace fma32
+
+#endif // MEMORY_RESOURCE_HPP
@@ -0,0 +1,303 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitwise.h"
+#include "memory_slab.h"
+
+/* Object size of each class */
+static const unsigned long slab_class_size[MEMORY_SLAB_CLASS_COUNT] = {8, 16, 24, 32, 48, 64, 96, 128};
+
+/* Class of the sizes by step of 8 bytes */
+static const unsigned char slab_class_table[MEMORY_SLAB_MAX_SIZE / MEMORY_SLAB_GRANULE] = {0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7};
+
+#define SLAB_HEADER_SIZE                        RESIZE_UP(sizeof(memory_slab_t), MEMORY_SLAB_GRANULE)
+
+/******************************************************************************
+ * slab_list_remove
+ * Remove a slab from a slab list
+ *
+ * [in] head : head of the list
+ * [in] slab : slab to remove
+ *****************************************************************************/
+STATIC void slab_list_remove(memory_slab_t ** head, memory_slab_t * slab)
+{
+  if(slab->prev == NULL)
+    *head = slab->next;
+  else
+    slab->prev->next = slab->next;
+  if(slab->next != NULL)
+    slab->next->prev = slab->prev;
+  slab->prev = NULL;
+  slab->next = NULL;
+}
+
+/******************************************************************************
+ * slab_list_push
+ * Insert a slab at the head of a slab list
+ *
+ * [in] head : head of the list
+ * [in] slab : slab to insert
+ *****************************************************************************/
+STATIC void slab_list_push(memory_slab_t ** head, memory_slab_t * slab)
+{
+  slab->prev = NULL;
+  slab->next = *head;
+  if(*head != NULL)
+    (*head)->prev = slab;
+  *head = slab;
+}
+
+/******************************************************************************
+ * slab_run_create
+ * Take a run of slabs from the heap, its slabs go to the empty list
+ *
+ * [in] allocator : slab allocator
+ *
+ * Return the first slab of the run or null if the heap is full
+ *****************************************************************************/
+STATIC memory_slab_t * slab_run_create(memory_slab_allocator_t * allocator)
+{
+  unsigned long count = MEMORY_SLAB_RUN_COUNT;
+  memory_slab_t * run;
+  memory_slab_t * slab;
+  unsigned long index;
+
+  /* The slabs are aligned on their size, a heap too full for a run gives one
+     slab. The last slab of a run leaves its tail to the header of the next
+     block, the chunk of a run taken after it is then aligned without gap */
+  run = (memory_slab_t *)memory_heap_memalign(allocator->heap, MEMORY_SLAB_SIZE, count * MEMORY_SLAB_SIZE - BLOCK_HEADER_SIZE_USED);
+  if((run == NULL) && (count > 1))
+  {
+    count = 1;
+    run = (memory_slab_t *)memory_heap_memalign(allocator->heap, MEMORY_SLAB_SIZE, MEMORY_SLAB_SIZE - BLOCK_HEADER_SIZE_USED);
+  }
+  if(run == NULL)
+    return NULL;
+
+  run->run_slabs = count;
+  run->run_used = 0;
+
+  /* The first slab of the run is at the head of the list */
+  for(index = count; index > 0; index--)
+  {
+    slab = (memory_slab_t *)((unsigned long)run + (index - 1) * MEMORY_SLAB_SIZE);
+    slab->magic = MEMORY_SLAB_MAGIC;
+    slab->allocator = allocator;
+    slab->run = run;
+    slab_list_push(&allocator->empty, slab);
+  }
+  allocator->empty_count += count;
+  return run;
+}
+
+/******************************************************************************
+ * slab_run_release
+ * Give back a run whose slabs are all empty to the heap
+ *
+ * [in] allocator : slab allocator
+ * [in] run       : first slab of the run
+ *****************************************************************************/
+STATIC void slab_run_release(memory_slab_allocator_t * allocator, memory_slab_t * run)
+{
+  memory_slab_t * slab;
+  unsigned long index;
+
+  for(index = 0; index < run->run_slabs; index++)
+  {
+    slab = (memory_slab_t *)((unsigned long)run + index * MEMORY_SLAB_SIZE);
+    slab_list_remove(&allocator->empty, slab);
+    slab->magic = 0;
+  }
+  allocator->empty_count -= run->run_slabs;
+  memory_heap_free(allocator->heap, run);
+}
+
+/******************************************************************************
+ * slab_create
+ * Get a new slab for a class, from the empty slabs or from a new run
+ *
+ * [in] allocator   : slab allocator
+ * [in] class_index : class of the objects
+ *
+ * Return the slab or null if the heap is full
+ *****************************************************************************/
+STATIC memory_slab_t * slab_create(memory_slab_allocator_t * allocator, unsigned long class_index)
+{
+  memory_slab_t * slab;
+  unsigned long length = MEMORY_SLAB_SIZE;
+  unsigned long index;
+
+  if((allocator->empty == NULL) && (slab_run_create(allocator) == NULL))
+    return NULL;
+
+  slab = allocator->empty;
+  slab_list_remove(&allocator->empty, slab);
+  allocator->empty_count--;
+  slab->run->run_used++;
+
+  /* The last slab of the run is shorter by a block header */
+  if(slab == (memory_slab_t *)((unsigned long)slab->run + (slab->run->run_slabs - 1) * MEMORY_SLAB_SIZE))
+    length -= BLOCK_HEADER_SIZE_USED;
+
+  slab->class_index = class_index;
+  slab->object_size = slab_class_size[class_index];
+  slab->object_count = (length - SLAB_HEADER_SIZE) / slab->object_size;
+  slab->free_count = slab->object_count;
+
+  /* Mark all the objects as free */
+  for(index = 0; index < MEMORY_SLAB_BITMAP_SIZE; index++)
+  {
+    if(slab->object_count >= (index + 1) * LONG_SIZE_BIT)
+      slab->bitmap[index] = ~0UL;
+    else if(slab->object_count > index * LONG_SIZE_BIT)
+      slab->bitmap[index] = (1UL << (slab->object_count - index * LONG_SIZE_BIT)) - 1;
+    else
+      slab->bitmap[index] = 0;
+  }
+
+  slab_list_push(&allocator->partial[class_index], slab);
+  return slab;
+}
+
+/******************************************************************************
+ * memory_slab_init
+ * Prepare a slab allocator taking its slabs from a heap
+ *
+ * [in] allocator : slab allocator
+ * [in] mma       : heap
+ *****************************************************************************/
+void memory_slab_init(memory_slab_allocator_t * allocator, memory_management_area_t * mma)
+{
+  unsigned long class_index;
+
+  allocator->heap = mma;
+  allocator->empty = NULL;
+  allocator->empty_count = 0;
+  for(class_index = 0; class_index < MEMORY_SLAB_CLASS_COUNT; class_index++)
+    allocator->partial[class_index] = NULL;
+}
+
+/******************************************************************************
+ * memory_slab_alloc
+ * Allocate a tiny object
+ *
+ * [in] allocator : slab allocator
+ * [in] size      : size of the object (up to MEMORY_SLAB_MAX_SIZE)
+ *
+ * Return the pointer of the object or null if error
+ *****************************************************************************/
+void * memory_slab_alloc(memory_slab_allocator_t * allocator, unsigned long size)
+{
+  memory_slab_t * slab;
+  unsigned long class_index;
+  unsigned long index;
+  unsigned long pos;
+
+  if(size > MEMORY_SLAB_MAX_SIZE)
+    return NULL;
+  if(size == 0)
+    size = 1;
+
+  class_index = slab_class_table[(size - 1) / MEMORY_SLAB_GRANULE];
+  slab = allocator->partial[class_index];
+  if(slab == NULL)
+  {
+    slab = slab_create(allocator, class_index);
+    if(slab == NULL)
+      return NULL;
+  }
+
+  /* Take the first free object */
+  for(index = 0; slab->bitmap[index] == 0; index++);
+  pos = bit_lowest_pos(slab->bitmap[index]);
+  slab->bitmap[index] &= ~(1UL << pos);
+
+  /* The slab is full, remove it from the partial list */
+  if(--slab->free_count == 0)
+    slab_list_remove(&allocator->partial[class_index], slab);
+
+  return (void *)((unsigned long)slab + SLAB_HEADER_SIZE + (index * LONG_SIZE_BIT + pos) * slab->object_size);
+}
+
+/******************************************************************************
+ * memory_slab_free
+ * Free a tiny object given by memory_slab_alloc, an object already free is
+ * ignored. The slab is found by masking the address, so any other pointer
+ * is an error like a pointer out of the heap for memory_heap_free
+ *
+ * [in] ptr : pointer the object to free
+ *****************************************************************************/
+void memory_slab_free(void * ptr)
+{
+  memory_slab_t * slab = MEMORY_SLAB_OF(ptr);
+  memory_slab_allocator_t * allocator;
+  unsigned long object;
+
+  /* Not an ownership check : it only catches the slabs given back to the heap
+     while their memory is not reused */
+  if(slab->magic != MEMORY_SLAB_MAGIC)
+    return;
+  allocator = slab->allocator;
+
+  object = ((unsigned long)ptr - (unsigned long)slab - SLAB_HEADER_SIZE) / slab->object_size;
+
+  /* A free object is already in the bitmap, a second free is ignored */
+  if(slab->bitmap[object / LONG_SIZE_BIT] & (1UL << (object % LONG_SIZE_BIT)))
+    return;
+  slab->bitmap[object / LONG_SIZE_BIT] |= 1UL << (object % LONG_SIZE_BIT);
+
+  /* The slab was full, it has now a free object */
+  if(slab->free_count++ == 0)
+    slab_list_push(&allocator->partial[slab->class_index], slab);
+
+  /* The slab is empty, its run goes back to the heap once all its slabs are
+     empty, unless there are no others empty slabs to keep as spare */
+  if(slab->free_count == slab->object_count)
+  {
+    slab_list_remove(&allocator->partial[slab->class_index], slab);
+    slab_list_push(&allocator->empty, slab);
+    allocator->empty_count++;
+    if((--slab->run->run_used == 0) && (allocator->empty_count > slab->run->run_slabs))
+      slab_run_release(allocator, slab->run);
+  }
+}
+
+/******************************************************************************
+ * memory_slab_trim
+ * Give back the runs whose slabs are all empty to the heap
+ *
+ * [in] allocator : slab allocator
+ *****************************************************************************/
+void memory_slab_trim(memory_slab_allocator_t * allocator)
+{
+  memory_slab_t * slab = allocator->empty;
+
+  while(slab != NULL)
+  {
+    /* A release takes out all the slabs of the run, start again from the head */
+    if(slab->run->run_used == 0)
+    {
+      slab_run_release(allocator, slab->run);
+      slab = allocator->empty;
+    }
+    else
+    {
+      slab = slab->next;
+    }
+  }
+}
@@ -0,0 +1,81 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORY_SLAB_H
+#define MEMORY_SLAB_H
+
+#include "memory.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of a slab, must be a power of two */
+#ifndef MEMORY_SLAB_SIZE
+#define MEMORY_SLAB_SIZE                        4096UL
+#endif /* MEMORY_SLAB_SIZE */
+
+/* Number of slabs taken at once from the heap, the aligned chunk of a run
+   wastes the gap before it once for all its slabs */
+#ifndef MEMORY_SLAB_RUN_COUNT
+#define MEMORY_SLAB_RUN_COUNT                   16
+#endif /* MEMORY_SLAB_RUN_COUNT */
+
+#define MEMORY_SLAB_MAGIC                       0x51AB51ABUL
+#define MEMORY_SLAB_MAX_SIZE                    128
+#define MEMORY_SLAB_CLASS_COUNT                 8
+#define MEMORY_SLAB_GRANULE                     8
+#define MEMORY_SLAB_BITMAP_SIZE                 ((MEMORY_SLAB_SIZE / MEMORY_SLAB_GRANULE) / LONG_SIZE_BIT)
+
+#define MEMORY_SLAB_OF(ptr)                     ((memory_slab_t *)RESIZE_DOWN(ptr, MEMORY_SLAB_SIZE))
+
+/* Slab header, at the start of each slab and followed by the objects.
+   The first slab of a run also counts the slabs of the run */
+typedef struct memory_slab_s {
+  unsigned long magic;
+  struct memory_slab_allocator_s * allocator;
+  struct memory_slab_s * prev;
+  struct memory_slab_s * next;
+  struct memory_slab_s * run;
+  unsigned long run_slabs;
+  unsigned long run_used;
+  unsigned long class_index;
+  unsigned long object_size;
+  unsigned long object_count;
+  unsigned long free_count;
+  unsigned long bitmap[MEMORY_SLAB_BITMAP_SIZE];
+} memory_slab_t;
+
+/* Slab allocator, the slabs are taken from a heap */
+typedef struct memory_slab_allocator_s {
+  memory_management_area_t * heap;
+  memory_slab_t * partial[MEMORY_SLAB_CLASS_COUNT];
+  memory_slab_t * empty;
+  unsigned long empty_count;
+} memory_slab_allocator_t;
+
+void memory_slab_init(memory_slab_allocator_t * allocator, memory_management_area_t * mma);
+void * memory_slab_alloc(memory_slab_allocator_t * allocator, unsigned long size);
+void memory_slab_free(void * ptr);
+void memory_slab_trim(memory_slab_allocator_t * allocator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMORY_SLAB_H */
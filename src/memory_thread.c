@@ -0,0 +1,245 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "memory_thread.h"
+
+/* Heap owned by the current thread */
+STATIC MEMORY_THREAD_LOCAL memory_thread_heap_t * thread_heap;
+
+/* All thread heaps, used to find the owner of a block freed by another thread */
+STATIC memory_thread_heap_t * thread_heap_list[MEMORY_THREAD_HEAP_MAX];
+STATIC unsigned long thread_heap_count;
+
+/******************************************************************************
+ * thread_heap_find
+ * Find the thread heap owning a pointer
+ *
+ * [in] ptr : pointer allocated by a thread heap
+ *
+ * Return the thread heap or null if the pointer is not in a thread heap
+ *****************************************************************************/
+STATIC memory_thread_heap_t * thread_heap_find(void * ptr)
+{
+  unsigned long index;
+  unsigned long count = __atomic_load_n(&thread_heap_count, __ATOMIC_ACQUIRE);
+  memory_thread_heap_t * th;
+
+  if(count > MEMORY_THREAD_HEAP_MAX)
+    count = MEMORY_THREAD_HEAP_MAX;
+
+  for(index = 0; index < count; index++)
+  {
+    /* The slot may be reserved but not yet filled */
+    th = __atomic_load_n(&thread_heap_list[index], __ATOMIC_ACQUIRE);
+    if((th != NULL) && ((unsigned long)ptr >= th->start) && ((unsigned long)ptr < th->end))
+      return th;
+  }
+  return NULL;
+}
+
+/******************************************************************************
+ * thread_heap_drain
+ * Free in the heap all the blocks pushed by other threads
+ *
+ * [in] th : thread heap owned by the current thread
+ *
+ * Return the number of freed blocks
+ *****************************************************************************/
+STATIC unsigned long thread_heap_drain(memory_thread_heap_t * th)
+{
+  unsigned long count = 0;
+  void * next;
+  void * ptr = __atomic_exchange_n(&th->remote_free, NULL, __ATOMIC_ACQUIRE);
+
+  while(ptr != NULL)
+  {
+    /* The link is stored in the first word of the freed memory */
+    next = *(void **)ptr;
+    memory_heap_free(th->heap, ptr);
+    ptr = next;
+    count++;
+  }
+  return count;
+}
+
+/******************************************************************************
+ * memory_thread_init
+ * Give a private heap to the current thread. If mem_ptr is null, the thread
+ * adopts a heap released by another thread
+ *
+ * [in] mem_ptr : memory pointer
+ * [in] length  : size of the memory
+ *
+ * Return 1 on success, 0 on error
+ *****************************************************************************/
+unsigned long memory_thread_init(void * address, unsigned long length)
+{
+  memory_thread_heap_t * th;
+  unsigned long index;
+  unsigned long count;
+
+  /* The thread has already a heap */
+  if(thread_heap != NULL)
+    return 0;
+
+  if(address == NULL)
+  {
+    /* Adopt an orphan heap */
+    count = __atomic_load_n(&thread_heap_count, __ATOMIC_ACQUIRE);
+    if(count > MEMORY_THREAD_HEAP_MAX)
+      count = MEMORY_THREAD_HEAP_MAX;
+    for(index = 0; index < count; index++)
+    {
+      unsigned long expected = 0;
+      th = __atomic_load_n(&thread_heap_list[index], __ATOMIC_ACQUIRE);
+      if((th != NULL) && __atomic_compare_exchange_n(&th->owned, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      {
+        thread_heap = th;
+        thread_heap_drain(th);
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  /* Align the thread heap */
+  if((unsigned long)address & ALIGN_MASK)
+  {
+    length -= RESIZE_UP(address, LONG_SIZE_BYTE) - (unsigned long)address;
+    address = (void *)RESIZE_UP(address, LONG_SIZE_BYTE);
+  }
+
+  if(length <= sizeof(memory_thread_heap_t))
+    return 0;
+
+  th = (memory_thread_heap_t *)address;
+  th->heap = memory_heap_init((void *)((unsigned long)address + sizeof(memory_thread_heap_t)), length - sizeof(memory_thread_heap_t));
+  if(th->heap == NULL)
+    return 0;
+
+  /* Reserve a slot in the list once the heap is built, a refused call takes none */
+  index = __atomic_load_n(&thread_heap_count, __ATOMIC_RELAXED);
+  do
+  {
+    if(index >= MEMORY_THREAD_HEAP_MAX)
+      return 0;
+  } while(!__atomic_compare_exchange_n(&thread_heap_count, &index, index + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  th->start = (unsigned long)address;
+  th->end = (unsigned long)address + length;
+  th->owned = 1;
+  th->remote_free = NULL;
+
+  /* Publish the heap */
+  __atomic_store_n(&thread_heap_list[index], th, __ATOMIC_RELEASE);
+  thread_heap = th;
+  return 1;
+}
+
+/******************************************************************************
+ * memory_thread_release
+ * Release the heap of the current thread. The heap stays known so blocks
+ * still in use can be freed from any thread, and it can be adopted later
+ *****************************************************************************/
+void memory_thread_release(void)
+{
+  memory_thread_heap_t * th = thread_heap;
+
+  if(th == NULL)
+    return;
+
+  thread_heap_drain(th);
+  thread_heap = NULL;
+  __atomic_store_n(&th->owned, 0, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * memory_thread_alloc
+ * Memory allocation in the heap of the current thread
+ *
+ * [in] size : size of the memory to allocate (in byte)
+ *
+ * Return the pointer of the allocated size or null if error
+ *****************************************************************************/
+void * memory_thread_alloc(unsigned long size)
+{
+  memory_thread_heap_t * th = thread_heap;
+
+  if(th == NULL)
+    return NULL;
+
+  /* Give back the blocks freed by other threads */
+  if(__atomic_load_n(&th->remote_free, __ATOMIC_RELAXED) != NULL)
+    thread_heap_drain(th);
+
+  return memory_heap_alloc(th->heap, size);
+}
+
+/******************************************************************************
+ * memory_thread_free
+ * Free a memory allocated by any thread heap. A block of another thread is
+ * pushed in the remote free list of its heap
+ *
+ * [in] ptr : pointer the memory to free
+ *****************************************************************************/
+void memory_thread_free(void * ptr)
+{
+  memory_thread_heap_t * th = thread_heap;
+  void * head;
+
+  /* Block of the current thread */
+  if((th != NULL) && ((unsigned long)ptr >= th->start) && ((unsigned long)ptr < th->end))
+  {
+    memory_heap_free(th->heap, ptr);
+    return;
+  }
+
+  /* Block of another thread */
+  th = thread_heap_find(ptr);
+  if(th == NULL)
+    return;
+
+  head = __atomic_load_n(&th->remote_free, __ATOMIC_RELAXED);
+  do
+  {
+    *(void **)ptr = head;
+  } while(!__atomic_compare_exchange_n(&th->remote_free, &head, ptr, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/******************************************************************************
+ * memory_thread_collect
+ * Free now the blocks of the current thread released by other threads
+ *
+ * Return the number of freed blocks
+ *****************************************************************************/
+unsigned long memory_thread_collect(void)
+{
+  if(thread_heap == NULL)
+    return 0;
+  return thread_heap_drain(thread_heap);
+}
+
+/******************************************************************************
+ * memory_thread_get_heap
+ * Get the heap of the current thread
+ *
+ * Return the heap or null if the thread has no heap
+ *****************************************************************************/
+memory_management_area_t * memory_thread_get_heap(void)
+{
+  return (thread_heap != NULL) ? thread_heap->heap : NULL;
+}
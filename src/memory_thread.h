@@ -0,0 +1,54 @@
+/*  This file is part of FMA32
+    Fast Memory Allocator for 32 bits embedded system.
+    (Romain CARITEY - 2014)
+
+    FMA32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FMA32 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FMA32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORY_THREAD_H
+#define MEMORY_THREAD_H
+
+#include "memory.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of thread heaps known by the process */
+#ifndef MEMORY_THREAD_HEAP_MAX
+#define MEMORY_THREAD_HEAP_MAX                  64
+#endif /* MEMORY_THREAD_HEAP_MAX */
+
+/* Thread heap, placed at the start of the memory area and followed by the
+   heap control block */
+typedef struct memory_thread_heap_s {
+  memory_management_area_t * heap;
+  unsigned long start;
+  unsigned long end;
+  unsigned long owned;
+  void * remote_free;
+} memory_thread_heap_t;
+
+unsigned long memory_thread_init(void * mem_ptr, unsigned long length);
+void memory_thread_release(void);
+void * memory_thread_alloc(unsigned long size);
+void memory_thread_free(void * ptr);
+unsigned long memory_thread_collect(void);
+memory_management_area_t * memory_thread_get_heap(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMORY_THREAD_H */
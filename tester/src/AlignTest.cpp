@@ -0,0 +1,101 @@
+#include "AlignTest.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define ALIGN_HEAP_SIZE     (1024 * 1024)
+#define ALIGN_ITERATION     100000
+#define ALIGN_MAX_SIZE      (4096 + 1)
+#define ALIGN_MAX_LOG2      12
+
+struct AlignedBlock {
+  unsigned char * Address;
+  unsigned long Size;
+  unsigned char Pattern;
+};
+
+const bool AlignTest::test(void *address, unsigned long length)
+{
+  std::vector<AlignedBlock> Blocks;
+
+  m_manager.MemoryInit(address, length);
+
+  for(unsigned long Counter = 0; Counter < ALIGN_ITERATION; Counter++)
+  {
+    // Mix aligned and not aligned allocations
+    unsigned long Alignment = 1UL << (rand() % (ALIGN_MAX_LOG2 + 1));
+    AlignedBlock Block = {nullptr, (unsigned long)(rand() % ALIGN_MAX_SIZE), (unsigned char)Counter};
+
+    Block.Address = (unsigned char *)((Alignment == 1) ? memory_alloc(Block.Size) : memory_memalign(Alignment, Block.Size));
+    if(Block.Address != nullptr)
+    {
+      // Every chunk is aligned on MEMORY_CHUNK_ALIGN at least
+      if(Alignment < MEMORY_CHUNK_ALIGN)
+        Alignment = MEMORY_CHUNK_ALIGN;
+      if((unsigned long)Block.Address & (Alignment - 1))
+      {
+        GetError() << "Block " << (void *)Block.Address << " not aligned on " << Alignment;
+        return false;
+      }
+      memset(Block.Address, Block.Pattern, Block.Size);
+      Blocks.push_back(Block);
+    }
+
+    if(!Blocks.empty() && (rand() & 1))
+    {
+      std::vector<AlignedBlock>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      for(unsigned long i = 0; i < iter->Size; i++)
+      {
+        if(iter->Address[i] != iter->Pattern)
+        {
+          GetError() << "Block " << (void *)iter->Address << " overwritten at offset " << i;
+          return false;
+        }
+      }
+      memory_free(iter->Address);
+      Blocks.erase(iter);
+    }
+  }
+
+  for(std::vector<AlignedBlock>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(iter->Address);
+
+  // Sizes whose rounding or padding wraps around are refused
+  const unsigned long Huge[] = {(unsigned long)-1, (unsigned long)-40, (unsigned long)-(2 * ALIGN_HEAP_SIZE)};
+  for(unsigned i = 0; i < sizeof(Huge) / sizeof(Huge[0]); i++)
+  {
+    for(unsigned long Alignment = 1; Alignment <= (1UL << ALIGN_MAX_LOG2); Alignment <<= 1)
+    {
+      if(memory_memalign(Alignment, Huge[i]) != nullptr)
+      {
+        GetError() << "Block of " << Huge[i] << " bytes aligned on " << Alignment << " allocated";
+        return false;
+      }
+    }
+    if((memory_alloc(Huge[i]) != nullptr) || (memory_aligned_alloc(16, Huge[i] & ~15UL) != nullptr))
+    {
+      GetError() << "Block of " << Huge[i] << " bytes allocated";
+      return false;
+    }
+  }
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool AlignTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[ALIGN_HEAP_SIZE];
+
+  bool TestPass = test(address, ALIGN_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,21 @@
+#ifndef ALIGNTEST_H
+#define ALIGNTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class AlignTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    AlignTest(const std::string testName) : TestBase(testName){}
+    ~AlignTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // ALIGNTEST_H
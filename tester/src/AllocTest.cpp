@@ -1,4 +1,23 @@
 #include "MemoryAllocTest.h"
+#include "HeapInstanceTest.h"
+#include "ThreadHeapTest.h"
+#include "SharedHeapTest.h"
+#include "CacheTest.h"
+#include "SlabTest.h"
+#include "ReallocTest.h"
+#include "AlignTest.h"
+#include "BatchTest.h"
+#include "PoolTest.h"
+#include "StatsTest.h"
+#include "ProbeTest.h"
+#include "TraceTest.h"
+#include "DeferTest.h"
+#include "FitTest.h"
+#include "OrderTest.h"
+#include "ResourceTest.h"
+#include "OsPoolTest.h"
+#include "LargePoolTest.h"
+#include "HeapHandleTest.h"
 
 int main()
 {
@@ -7,6 +26,77 @@ int main()
   // Check allocation / free tests
   test.Register(new MemoryAllocTest("Alloc/Free tests"));
 
+  // Check independent heap instances
+  test.Register(new HeapInstanceTest("Heap instance tests"));
+
+  // Check per thread heaps with cross thread free
+  test.Register(new ThreadHeapTest("Thread heap tests"));
+
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+  // Check one heap shared by several threads
+  test.Register(new SharedHeapTest("Shared heap tests"));
+#endif /* MEMORY_LOCK */
+
+  // Check the thread cache in front of a heap
+  test.Register(new CacheTest("Thread cache tests"));
+
+  // Check the slab allocator for tiny objects
+  test.Register(new SlabTest("Slab tests"));
+
+  // Check in place resize and move of blocks
+  test.Register(new ReallocTest("Realloc tests"));
+
+  // Check aligned allocations
+  test.Register(new AlignTest("Aligned alloc tests"));
+
+  // Check batch allocations and batch free
+  test.Register(new BatchTest("Batch alloc/free tests"));
+
+  // Check a heap made of several pools
+  test.Register(new PoolTest("Pool tests"));
+
+#if MEMORY_STATS
+  // Check the allocation statistics against the blocks of the heap
+  test.Register(new StatsTest("Statistics tests"));
+#endif /* MEMORY_STATS */
+
+#if MEMORY_PROBES
+  // Check the probes of the block operations
+  test.Register(new ProbeTest("Probe tests"));
+#endif /* MEMORY_PROBES */
+
+#if MEMORY_TRACE
+  // Check the trace records of memory_alloc and memory_free
+  test.Register(new TraceTest("Trace tests"));
+#endif /* MEMORY_TRACE */
+
+#if MEMORY_DEFER
+  // Check the deferred coalescing
+  test.Register(new DeferTest("Deferred coalescing tests"));
+#endif /* MEMORY_DEFER */
+
+#if MEMORY_GOOD_FIT
+  // Check the good fit scan of the list of the size
+  test.Register(new FitTest("Good fit tests"));
+#endif /* MEMORY_GOOD_FIT */
+
+#if MEMORY_ADDRESS_ORDER
+  // Check the free lists sorted by address
+  test.Register(new OrderTest("Address order tests"));
+#endif /* MEMORY_ADDRESS_ORDER */
+
+  // Check the containers of the standard library on a heap
+  test.Register(new ResourceTest("Memory resource tests"));
+
+  // Check the pools reserved from the system
+  test.Register(new OsPoolTest("OS pool tests"));
+
+  // Check a pool of several GiB
+  test.Register(new LargePoolTest("Large pool tests"));
+
+  // Check the C++ heap handle against memory.c
+  test.Register(new HeapHandleTest("Heap handle tests"));
+
   test.Run();
   return 0;
 }
@@ -0,0 +1,151 @@
+#include "BatchTest.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define BATCH_HEAP_SIZE     (1024 * 1024)
+#define BATCH_ITERATION     20000
+#define BATCH_MAX_SIZE      (512 + 1)
+#define BATCH_MAX_COUNT     64
+
+struct BatchBlock {
+  unsigned char * Address;
+  unsigned long Size;
+  unsigned char Pattern;
+};
+
+// Check the pattern of a block
+static bool CheckBlock(const BatchBlock & Block)
+{
+  for(unsigned long i = 0; i < Block.Size; i++)
+  {
+    if(Block.Address[i] != Block.Pattern)
+      return false;
+  }
+  return true;
+}
+
+const bool BatchTest::test(void *address, unsigned long length)
+{
+  std::vector<BatchBlock> Blocks;
+  void * Ptrs[BATCH_MAX_COUNT + 1];
+
+  m_manager.MemoryInit(address, length);
+
+  for(unsigned long Counter = 0; Counter < BATCH_ITERATION; Counter++)
+  {
+    unsigned long Size = rand() % BATCH_MAX_SIZE;
+    unsigned long Count = 1 + rand() % BATCH_MAX_COUNT;
+
+    unsigned long Done = memory_alloc_batch(Size, Count, Ptrs);
+    if(Done > Count)
+    {
+      GetError() << "Batch of " << Count << " gives " << Done << " blocks";
+      return false;
+    }
+    for(unsigned long Index = 0; Index < Done; Index++)
+    {
+      BatchBlock Block = {(unsigned char *)Ptrs[Index], Size, (unsigned char)(Counter + Index)};
+      if(((unsigned long)Block.Address & (MEMORY_CHUNK_ALIGN - 1)) || (memory_usable_size(Block.Address) < Size))
+      {
+        GetError() << "Block " << (void *)Block.Address << " of " << memory_usable_size(Block.Address) << " bytes for " << Size;
+        return false;
+      }
+      memset(Block.Address, Block.Pattern, Block.Size);
+      Blocks.push_back(Block);
+    }
+
+    // Free a random set of blocks, with a null pointer
+    unsigned long FreeCount = Blocks.empty() ? 0 : rand() % (BATCH_MAX_COUNT + 1);
+    unsigned long Index = 0;
+    while((Index < FreeCount) && !Blocks.empty())
+    {
+      std::vector<BatchBlock>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      if(!CheckBlock(*iter))
+      {
+        GetError() << "Block " << (void *)iter->Address << " overwritten";
+        return false;
+      }
+      Ptrs[Index++] = iter->Address;
+      Blocks.erase(iter);
+    }
+    Ptrs[Index++] = nullptr;
+    memory_free_batch(Ptrs, Index);
+  }
+
+  // A batch bigger than the heap stops when the heap is full
+  unsigned long Done = memory_alloc_batch(length / BATCH_MAX_COUNT, BATCH_MAX_COUNT, Ptrs);
+  if(Done == BATCH_MAX_COUNT)
+  {
+    GetError() << "Batch bigger than the heap allocated";
+    return false;
+  }
+  memory_free_batch(Ptrs, Done);
+
+  // Sizes whose rounding or whole batch size wraps around give no block
+  const unsigned long Huge[] = {(unsigned long)-1, (unsigned long)-3, (unsigned long)-(2 * BATCH_HEAP_SIZE), 1UL << (LONG_SIZE_BIT - 2)};
+  for(unsigned i = 0; i < sizeof(Huge) / sizeof(Huge[0]); i++)
+  {
+    Done = memory_alloc_batch(Huge[i], 4, Ptrs);
+    if(Done != 0)
+    {
+      GetError() << "Batch of " << Huge[i] << " bytes gives " << Done << " blocks";
+      return false;
+    }
+  }
+
+  // A huge count of small blocks stops when the heap is full
+  std::vector<void *> Many(length / 16);
+  Done = memory_alloc_batch(64, (unsigned long)-1 / 2, Many.data());
+  if((Done == 0) || (Done > Many.size()))
+  {
+    GetError() << "Batch of a huge count gives " << Done << " blocks";
+    return false;
+  }
+  for(unsigned long Index = 0; Index < Done; Index++)
+  {
+    if(memory_usable_size(Many[Index]) < 64)
+    {
+      GetError() << "Block " << Many[Index] << " of " << memory_usable_size(Many[Index]) << " bytes for 64";
+      return false;
+    }
+  }
+  memory_free_batch(Many.data(), Done);
+
+  // Free the rest by batch in allocation order
+  while(!Blocks.empty())
+  {
+    unsigned long Count = (Blocks.size() < BATCH_MAX_COUNT) ? Blocks.size() : BATCH_MAX_COUNT;
+    for(unsigned long Index = 0; Index < Count; Index++)
+    {
+      if(!CheckBlock(Blocks[Index]))
+      {
+        GetError() << "Block " << (void *)Blocks[Index].Address << " overwritten";
+        return false;
+      }
+      Ptrs[Index] = Blocks[Index].Address;
+    }
+    memory_free_batch(Ptrs, Count);
+    Blocks.erase(Blocks.begin(), Blocks.begin() + Count);
+  }
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool BatchTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[BATCH_HEAP_SIZE];
+
+  bool TestPass = test(address, BATCH_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
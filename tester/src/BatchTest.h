@@ -0,0 +1,21 @@
+#ifndef BATCHTEST_H
+#define BATCHTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class BatchTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    BatchTest(const std::string testName) : TestBase(testName){}
+    ~BatchTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // BATCHTEST_H
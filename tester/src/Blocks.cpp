@@ -3,11 +3,11 @@
 #include <cstring>
 #include "bitwise.h"
 
-extern memory_management_area_t mma;
+extern memory_management_area_t * mma;
 
 MemoryBlock * MemoryBlockManager::Alloc(unsigned long length)
 {
-	memory_block_t * real_block = (memory_block_t *)memory_alloc(length);
+	memory_block_t * real_block = (memory_block_t *)(m_default ? memory_alloc(length) : memory_heap_alloc(m_mma, length));
 	if(real_block == nullptr)
     return nullptr;
 
@@ -25,40 +25,62 @@ MemoryBlock * MemoryBlockManager::Alloc(unsigned long length)
 void MemoryBlockManager::Free(MemoryBlock *block)
 {
 	void * ptr = (void *)((unsigned long)block->GetAddress() + BLOCK_HEADER_SIZE_USED);
-	memory_free(ptr);
+	if(m_default)
+		memory_free(ptr);
+	else
+		memory_heap_free(m_mma, ptr);
 	delete block;
 }
 
 void MemoryBlockManager::MemoryInit(void * mem_addr, unsigned long mem_size)
 {
 	memory_init(mem_addr, mem_size);
+	m_mma = mma;
+	m_default = true;
+	Snapshot();
+}
 
-	m_mma = (void *)mma.first_level;
+void MemoryBlockManager::HeapInit(void * mem_addr, unsigned long mem_size)
+{
+	m_mma = memory_heap_init(mem_addr, mem_size);
+	m_default = false;
+	Snapshot();
+}
+
+void MemoryBlockManager::HeapAttach(memory_management_area_t * heap)
+{
+	m_mma = heap;
+	m_default = false;
+	Snapshot();
+}
 
+void MemoryBlockManager::Snapshot(void)
+{
 	// Build the footprint of the initial memory state
-  unsigned long mma_area_size;
-  m_maxFirstLevel = bit_highest_pos(bit_next_power_of_two((unsigned long)mem_size)) - 6;
+  m_maxFirstLevel = m_mma->fl_count;
 
 	/* Set the first level in the MMA */
-	m_first_level = *(unsigned long *)m_mma;
-	mma_area_size = 4;
+	m_first_level = m_mma->first_level;
 
 	/* Set the second level in the MMA */
-	unsigned long *ptr_fl = (unsigned long *)((unsigned long)mem_addr + mma_area_size);
 	for(unsigned counter = 0; counter < m_maxFirstLevel; counter++)
-    m_second_level[counter] = ptr_fl[counter];
-	mma_area_size += m_maxFirstLevel * 4;
+    m_second_level[counter] = MEMORY_SECOND_LEVEL(m_mma)[counter];
 
 	/* Set the fbla */
-	memory_block_t *(*fbla)[32] = (memory_block_t *(*)[32])((unsigned long)mem_addr + mma_area_size);
 	for(unsigned long fl = 0; fl < m_maxFirstLevel; fl++)
-    for(unsigned long sl = 0; sl < 32; sl++)
-      m_fbla[fl][sl] = fbla[fl][sl];
-
-	mma_area_size += m_maxFirstLevel * (32 * 4);
-  m_maa = (memory_block_t *)((unsigned long)mem_addr + mma_area_size);
+    for(unsigned long sl = 0; sl < MEMORY_SL_COUNT; sl++)
+      m_fbla[fl][sl] = MEMORY_FBLA(m_mma)[fl][sl];
+
+	/* The first block follows the fbla and the free block histogram, its chunk is aligned */
+  m_maa = (memory_block_t *)MEMORY_FREE_BLOCKS(m_mma);
+#if MEMORY_STATS
+  m_maa = (memory_block_t *)((unsigned long)m_maa + m_maxFirstLevel * MEMORY_SL_COUNT * LONG_SIZE_BYTE);
+#endif /* MEMORY_STATS */
+  m_maa = BLOCK_ALIGN_START(m_maa);
   m_first_block.size = m_maa->size;
+#if !MEMORY_COMPACT_HEADER
   m_first_block.phys_prev = m_maa->phys_prev;
+#endif /* MEMORY_COMPACT_HEADER */
   m_first_block.next = m_maa->next;
   m_first_block.prev = m_maa->prev;
 }
@@ -85,17 +107,32 @@ const bool MemoryBlockManager::CheckInitalMemory(void)
 {
   memory_block_t * block = m_maa;
 
+#if MEMORY_DEFER
+  // The parked blocks go back to the free lists first
+  memory_heap_coalesce(m_mma);
+#endif /* MEMORY_DEFER */
+
 	if(m_first_block.size != block->size)
   {
     m_err << "Memory integrity error on size : expected " << m_first_block.size << " has " << block->size;
     return false;
   }
 
+#if MEMORY_COMPACT_HEADER
+  // The free block ends with its own address
+  memory_block_t * footer = ((memory_block_t **)((unsigned long)block + BLOCK_GET_MASKED_SIZE(block) + BLOCK_HEADER_SIZE_USED))[-1];
+  if(footer != block)
+  {
+    m_err << "Memory integrity error on the last word of the block : expected " << block << " has " << footer;
+    return false;
+  }
+#else
   if(m_first_block.phys_prev != block->phys_prev)
   {
     m_err << "Memory integrity error on phys_prev pointer: expected " << m_first_block.phys_prev << " has " << block->phys_prev;
     return false;
   }
+#endif /* MEMORY_COMPACT_HEADER */
 
   if(m_first_block.next != block->next)
   {
@@ -110,33 +147,29 @@ const bool MemoryBlockManager::CheckInitalMemory(void)
   }
 
   /* Set the first level in the MMA */
-	if(m_first_level != *(unsigned long *)(m_mma))
+	if(m_first_level != m_mma->first_level)
   {
-    m_err << "Memory integrity error on FL : expected " << m_first_level << " has " <<*(unsigned long *)(m_mma);
+    m_err << "Memory integrity error on FL : expected " << m_first_level << " has " << m_mma->first_level;
     return false;
   }
 
-	unsigned long mma_area_size = 4;
-	unsigned long *ptr_fl = (unsigned long *)((unsigned long)m_mma + mma_area_size);
 	for(unsigned counter = 0; counter < m_maxFirstLevel; counter++)
   {
-    if(m_second_level[counter] != ptr_fl[counter])
+    if(m_second_level[counter] != MEMORY_SECOND_LEVEL(m_mma)[counter])
     {
-      m_err << "Memory integrity error on SL : expected " << m_second_level[counter] << " has " << ptr_fl[counter];
+      m_err << "Memory integrity error on SL : expected " << m_second_level[counter] << " has " << MEMORY_SECOND_LEVEL(m_mma)[counter];
       return false;
     }
   }
-	mma_area_size += m_maxFirstLevel * 4;
 
-	memory_block_t *(*fbla)[32] = (memory_block_t *(*)[32])((unsigned long)m_mma + mma_area_size);
 	for(unsigned long fl = 0; fl < m_maxFirstLevel; fl++)
   {
 
-    for(unsigned long sl = 0; sl < 32; sl++)
+    for(unsigned long sl = 0; sl < MEMORY_SL_COUNT; sl++)
     {
-      if(m_fbla[fl][sl] != fbla[fl][sl])
+      if(m_fbla[fl][sl] != MEMORY_FBLA(m_mma)[fl][sl])
       {
-        m_err << "Memory integrity error on SL : expected " << m_fbla[fl][sl] << " has " << fbla[fl][sl];
+        m_err << "Memory integrity error on SL : expected " << m_fbla[fl][sl] << " has " << MEMORY_FBLA(m_mma)[fl][sl];
         return false;
       }
     }
@@ -144,3 +177,56 @@ const bool MemoryBlockManager::CheckInitalMemory(void)
   return true;
 }
 
+// Walk the blocks of the first pool and check the links between physical neighbours
+const bool MemoryBlockManager::CheckBlocks(void)
+{
+  memory_block_t * prev = nullptr;
+  bool prevFree = false;
+  memory_block_t * block = m_maa;
+
+  while(1)
+  {
+    // A parked block is free but out of the free lists and not merged
+    bool isFree = BLOCK_IS_FREE(block);
+#if MEMORY_DEFER
+    isFree = isFree && (block->prev != BLOCK_PARKED_LINK);
+#endif /* MEMORY_DEFER */
+
+    if(prevFree && isFree)
+    {
+      m_err << "Blocks " << prev << " and " << block << " are free and not merged";
+      return false;
+    }
+#if MEMORY_COMPACT_HEADER
+    if((prev == nullptr) && BLOCK_IS_PREV_FREE(block))
+    {
+      m_err << "First block " << block << " has a free previous block";
+      return false;
+    }
+    if((prev != nullptr) && prevFree && (!BLOCK_IS_PREV_FREE(block) || (((memory_block_t **)block)[-1] != prev)))
+    {
+      m_err << "Block " << block << " does not link its free previous block " << prev;
+      return false;
+    }
+    if((prev != nullptr) && !BLOCK_IS_FREE(prev) && BLOCK_IS_PREV_FREE(block))
+    {
+      m_err << "Block " << block << " has a free previous block but " << prev << " is used";
+      return false;
+    }
+#else
+    memory_link_t prevLink = (prev == nullptr) ? BLOCK_NO_LINK : BLOCK_TO_LINK(m_mma, prev);
+    if(block->phys_prev != prevLink)
+    {
+      m_err << "Block " << block << " has the previous block link " << block->phys_prev << " instead of " << prevLink;
+      return false;
+    }
+#endif /* MEMORY_COMPACT_HEADER */
+
+    if(BLOCK_IS_LAST(block))
+      break;
+    prev = block;
+    prevFree = isFree;
+    block = (memory_block_t *)((unsigned long)block + BLOCK_GET_MASKED_SIZE(block) + BLOCK_HEADER_SIZE_USED);
+  }
+  return true;
+}
@@ -32,23 +32,31 @@ class MemoryBlockManager
 		virtual ~MemoryBlockManager(){}
 
 		void MemoryInit(void * mem_addr, unsigned long mem_size);
+		void HeapInit(void * mem_addr, unsigned long mem_size);
+		void HeapAttach(memory_management_area_t * heap);
 		MemoryBlock * Alloc(unsigned long length);
 		void Free(MemoryBlock *block);
 
 		const bool CheckInitalMemory(void);
+		const bool CheckBlocks(void);
 		bool CheckNumberOfAllocation(unsigned long nb_alloc);
 		void PrintMemory(void);
 		unsigned long GetMemorySize(void);
+		memory_management_area_t * GetHeap(void) const {return m_mma;}
+		memory_block_t * GetFirstBlock(void) const {return m_maa;}
     const std::stringstream & GetError(void) const {return m_err;}
 
 	private:
+		void Snapshot(void);
+
 		memory_block_t * m_maa;
-		void * m_mma;
+		memory_management_area_t * m_mma;
+		bool m_default;
 
     unsigned long m_maxFirstLevel;
 		unsigned long m_first_level;
-		unsigned long m_second_level[25];
-		memory_block_t * m_fbla[25][32];
+		unsigned long m_second_level[LONG_SIZE_BIT];
+		memory_link_t m_fbla[LONG_SIZE_BIT][MEMORY_SL_COUNT];
 		memory_block_t m_first_block;
     std::stringstream  m_err;
 };
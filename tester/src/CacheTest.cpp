@@ -0,0 +1,133 @@
+#include "CacheTest.h"
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "memory_cache.h"
+
+#define CACHE_HEAP_SIZE      (256 * 1024)
+#define CACHE_ITERATION      200000
+#define CACHE_MAX_ALLOC      (MEMORY_CACHE_MAX_SIZE + 64)
+#define CACHE_THREAD_COUNT   4
+
+const bool CacheTest::test(void *address, unsigned long length)
+{
+  std::vector<void *> Blocks;
+  memory_management_area_t * heap;
+
+  m_manager.HeapInit(address, length);
+  heap = m_manager.GetHeap();
+
+  // A freed small block is given back by the next allocation of the same size
+  void * ptr = memory_cache_alloc(heap, 24);
+  memory_cache_free(heap, ptr);
+  if(memory_cache_alloc(heap, 24) != ptr)
+  {
+    GetError() << "Cached block " << ptr << " not reused";
+    return false;
+  }
+  memory_cache_free(heap, ptr);
+
+  // A second free of a cached block is ignored, the block is given once
+  void * other = memory_cache_alloc(heap, 24);
+  memory_cache_free(heap, other);
+  memory_cache_free(heap, ptr);
+  memory_cache_free(heap, other);
+  void * first = memory_cache_alloc(heap, 24);
+  void * second = memory_cache_alloc(heap, 24);
+  void * third = memory_cache_alloc(heap, 24);
+  if((first == second) || (first == third) || (second == third))
+  {
+    GetError() << "Cached block given twice after a double free";
+    return false;
+  }
+
+  memory_cache_free(heap, first);
+  memory_cache_free(heap, second);
+  memory_cache_free(heap, third);
+  memory_cache_flush();
+
+  // A second free of a block free in the heap is ignored too, its
+  // neighbours stay allocated so that it keeps its own header
+  void * before = memory_heap_alloc(heap, 24);
+  void * freed = memory_heap_alloc(heap, 24);
+  void * after = memory_heap_alloc(heap, 24);
+  memory_heap_free(heap, freed);
+  memory_cache_free(heap, freed);
+  if(memory_cache_get_bytes() != 0)
+  {
+    GetError() << "Block free in the heap kept by the cache";
+    return false;
+  }
+  memory_heap_free(heap, before);
+  memory_heap_free(heap, after);
+
+  for(unsigned long Counter = 0; Counter < CACHE_ITERATION; Counter++)
+  {
+    ptr = memory_cache_alloc(heap, rand() % CACHE_MAX_ALLOC);
+    if(ptr != nullptr)
+      Blocks.push_back(ptr);
+
+    if(!Blocks.empty() && (rand() & 1))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      memory_cache_free(heap, *iter);
+      Blocks.erase(iter);
+    }
+
+    if(memory_cache_get_bytes() > MEMORY_CACHE_BYTES_LIMIT)
+    {
+      GetError() << "Cache size " << memory_cache_get_bytes() << " over the limit";
+      return false;
+    }
+  }
+
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_cache_free(heap, *iter);
+
+  // Nothing must stay in the cache after a flush
+  memory_cache_flush();
+  if(memory_cache_get_bytes() != 0)
+  {
+    GetError() << "Cache not empty after flush";
+    return false;
+  }
+
+  // The cache of a thread is flushed when it exits, one thread at a time
+  // for the heaps without lock
+  for(unsigned Index = 0; Index < CACHE_THREAD_COUNT; Index++)
+  {
+    std::thread Worker([heap, Index]()
+    {
+      std::vector<void *> Kept;
+      for(unsigned long Counter = 0; Counter < CACHE_ITERATION / 100; Counter++)
+      {
+        void * ptr = memory_cache_alloc(heap, (Counter * (Index + 1)) % MEMORY_CACHE_MAX_SIZE);
+        if(ptr != nullptr)
+          Kept.push_back(ptr);
+      }
+      for(std::vector<void *>::iterator iter = Kept.begin(); iter != Kept.end(); iter++)
+        memory_cache_free(heap, *iter);
+    });
+    Worker.join();
+  }
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool CacheTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[CACHE_HEAP_SIZE];
+
+  bool TestPass = test(address, CACHE_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,21 @@
+#ifndef CACHETEST_H
+#define CACHETEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class CacheTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    CacheTest(const std::string testName) : TestBase(testName){}
+    ~CacheTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // CACHETEST_H
@@ -0,0 +1,142 @@
+#include "DeferTest.h"
+#include <cstdlib>
+#include <vector>
+
+// The test reads the parked block counter of the heap
+#if MEMORY_DEFER
+
+#define DEFER_HEAP_SIZE     (256 * 1024)
+#define DEFER_ITERATION     20000
+#define DEFER_MAX_ALLOC     (2 * MEMORY_DEFER_MAX_SIZE)
+#define DEFER_LIMIT         16
+
+const bool DeferTest::test(void *address, unsigned long length)
+{
+  std::vector<void *> Blocks;
+
+  m_manager.MemoryInit(address, length);
+  memory_management_area_t * Heap = m_manager.GetHeap();
+
+  // A freed block is parked and given back as is to the same size
+  void * First = memory_alloc(100);
+  void * Second = memory_alloc(100);
+  void * Third = memory_alloc(100);
+  memory_free(Second);
+  memory_block_t * Block = (memory_block_t *)((unsigned long)Second - BLOCK_HEADER_SIZE_USED);
+  if(!BLOCK_IS_FREE(Block) || (Block->prev != BLOCK_PARKED_LINK) || (Heap->defer_count != 1))
+  {
+    GetError() << "Freed block not parked";
+    return false;
+  }
+  if(memory_alloc(100) != Second)
+  {
+    GetError() << "Parked block not reused by the same size";
+    return false;
+  }
+
+  // The neighbours of a parked block do not merge with it
+  memory_free(Second);
+  memory_free(First);
+  memory_free(Third);
+  if(Heap->defer_count != 3)
+  {
+    GetError() << Heap->defer_count << " parked blocks instead of 3";
+    return false;
+  }
+  if(memory_coalesce() != 3)
+  {
+    GetError() << "Coalescing does not merge the 3 parked blocks";
+    return false;
+  }
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+
+  // The backlog is bounded by the limit
+  memory_set_defer_limit(DEFER_LIMIT);
+  for(unsigned long Counter = 0; Counter < 4 * DEFER_LIMIT; Counter++)
+    Blocks.push_back(memory_alloc(8 + Counter % MEMORY_DEFER_MAX_SIZE));
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+  {
+    memory_free(*iter);
+    if(Heap->defer_count > DEFER_LIMIT)
+    {
+      GetError() << Heap->defer_count << " parked blocks over the limit " << DEFER_LIMIT;
+      return false;
+    }
+  }
+  Blocks.clear();
+
+  // A failed search merges the parked blocks, the whole heap is available again
+  void * Ptr;
+  while((Ptr = memory_alloc(64)) != nullptr)
+    Blocks.push_back(Ptr);
+  memory_set_defer_limit(Blocks.size());
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(*iter);
+  if(Heap->defer_count != Blocks.size())
+  {
+    GetError() << Heap->defer_count << " parked blocks after " << Blocks.size() << " frees";
+    return false;
+  }
+  Blocks.clear();
+  Ptr = memory_alloc(length / 2);
+  if((Ptr == nullptr) || (Heap->defer_count != 0))
+  {
+    GetError() << "Parked blocks not merged by a failed search";
+    return false;
+  }
+  memory_free(Ptr);
+  memory_set_defer_limit(MEMORY_DEFER_BACKLOG);
+
+  // Without limit every free merges
+  memory_set_defer_limit(0);
+  Ptr = memory_alloc(64);
+  memory_free(Ptr);
+  if(Heap->defer_count != 0)
+  {
+    GetError() << "Block parked with a null limit";
+    return false;
+  }
+  memory_set_defer_limit(MEMORY_DEFER_BACKLOG);
+
+  // Random workload around the size limit
+  for(unsigned long Counter = 0; Counter < DEFER_ITERATION; Counter++)
+  {
+    Ptr = memory_alloc(rand() % DEFER_MAX_ALLOC);
+    if(Ptr != nullptr)
+      Blocks.push_back(Ptr);
+    if(!Blocks.empty() && (rand() & 1))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      memory_free(*iter);
+      Blocks.erase(iter);
+    }
+  }
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(*iter);
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool DeferTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[DEFER_HEAP_SIZE];
+
+  bool TestPass = test(address, DEFER_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
+
+#endif /* MEMORY_DEFER */
@@ -0,0 +1,21 @@
+#ifndef DEFERTEST_H
+#define DEFERTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class DeferTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    DeferTest(const std::string testName) : TestBase(testName){}
+    ~DeferTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // DEFERTEST_H
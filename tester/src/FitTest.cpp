@@ -0,0 +1,100 @@
+#include "FitTest.h"
+#include <cstdlib>
+#include <vector>
+
+#define FIT_HEAP_SIZE       (256 * 1024)
+#define FIT_ITERATION       20000
+#define FIT_MAX_ALLOC       4096
+// Not the first size of its second level, the next level search skips its list
+#define FIT_SIZE            1000
+
+const bool FitTest::test(void *address, unsigned long length)
+{
+  std::vector<void *> Blocks;
+
+  m_manager.MemoryInit(address, length);
+  // The freed blocks go to the free lists at once
+  memory_set_defer_limit(0);
+
+  // A freed block of the size is in the list of the size, between two used blocks
+  void * First = memory_alloc(FIT_SIZE);
+  void * Guard = memory_alloc(64);
+  void * Second = memory_alloc(FIT_SIZE - LONG_SIZE_BYTE);
+  void * Tail = memory_alloc(64);
+  memory_free(First);
+  if(memory_alloc(FIT_SIZE) != First)
+  {
+    GetError() << "Good fit does not take the free block of the size";
+    return false;
+  }
+
+  // Without scan the next level search takes an other block
+  memory_set_fit_scan(0);
+  memory_free(First);
+  void * Other = memory_alloc(FIT_SIZE);
+  if((Other == nullptr) || (Other == First))
+  {
+    GetError() << "Next level search takes the block of the list of the size";
+    return false;
+  }
+  memory_free(Other);
+  memory_set_fit_scan(MEMORY_GOOD_FIT_SCAN);
+
+  // A smaller block of the same list does not fit
+  memory_free(Second);
+  void * Bigger = memory_alloc(FIT_SIZE);
+  if((Bigger == nullptr) || (Bigger == Second) || (memory_usable_size(Bigger) < FIT_SIZE))
+  {
+    GetError() << "Good fit takes a block smaller than the size";
+    return false;
+  }
+  memory_free(Bigger);
+  memory_free(Guard);
+  memory_free(Tail);
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+
+  // Random workload, the links of the blocks stay consistent
+  for(unsigned long Counter = 0; Counter < FIT_ITERATION; Counter++)
+  {
+    void * Ptr = memory_alloc(1 + rand() % FIT_MAX_ALLOC);
+    if(Ptr != nullptr)
+      Blocks.push_back(Ptr);
+    if(!Blocks.empty() && (rand() & 1))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      memory_free(*iter);
+      Blocks.erase(iter);
+    }
+  }
+  if(m_manager.CheckBlocks() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(*iter);
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool FitTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[FIT_HEAP_SIZE];
+
+  bool TestPass = test(address, FIT_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
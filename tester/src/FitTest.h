@@ -0,0 +1,21 @@
+#ifndef FITTEST_H
+#define FITTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class FitTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    FitTest(const std::string testName) : TestBase(testName){}
+    ~FitTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // FITTEST_H
@@ -0,0 +1,184 @@
+#include "HeapHandleTest.h"
+#include "fma32.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define HANDLE_HEAP_SIZE      (256 * 1024)
+#define HANDLE_ITERATION      20000
+#define HANDLE_MAX_ALLOC      (2048 + 1)
+#define HANDLE_LEVEL_SIZES    (64 * 1024)
+
+extern "C" void block_get_levels(unsigned long size, memory_level_t *level);
+extern "C" unsigned long block_get_next_level(unsigned long size, memory_level_t *level);
+
+// The configuration is the one memory.c is built with
+typedef fma32::Heap CHeap;
+
+// The levels of the constant sizes are computed by the compiler
+static_assert(CHeap::GetAllocSize(1) == BLOCK_MIN_ALLOC_SIZE, "Minimum block size differs from memory.c");
+static_assert(CHeap::GetAllocLevel(BLOCK_MIN_SIZE).fl == 0, "Minimum block size out of the first level");
+
+static bool SameLevel(const memory_level_t & Left, const memory_level_t & Right)
+{
+  return (Left.fl == Right.fl) && (Left.sl == Right.sl) && (Left.fl_bitmap == Right.fl_bitmap) && (Left.sl_bitmap == Right.sl_bitmap);
+}
+
+// The compile time levels are the ones of memory.c
+const bool HeapHandleTest::testLevels(void)
+{
+  std::vector<unsigned long> Sizes;
+
+  for(unsigned long Size = 0; Size < HANDLE_LEVEL_SIZES; Size++)
+    Sizes.push_back(Size);
+  for(unsigned long Bit = 16; Bit < sizeof(unsigned long) * 8 - 1; Bit++)
+  {
+    Sizes.push_back((1UL << Bit) - 1);
+    Sizes.push_back(1UL << Bit);
+    Sizes.push_back((1UL << Bit) + (1UL << (Bit - MEMORY_SL_LOG2)));
+  }
+
+  for(std::vector<unsigned long>::iterator iter = Sizes.begin(); iter != Sizes.end(); iter++)
+  {
+    memory_level_t Level;
+    block_get_levels(*iter, &Level);
+    if(!SameLevel(Level, CHeap::GetLevel(*iter)))
+    {
+      GetError() << "Level of " << *iter << " bytes " << CHeap::GetLevel(*iter).fl << "/" << CHeap::GetLevel(*iter).sl << " instead of " << Level.fl << "/" << Level.sl;
+      return false;
+    }
+    if(block_get_next_level(*iter, &Level) && !SameLevel(Level, CHeap::GetNextLevel(*iter)))
+    {
+      GetError() << "Next level of " << *iter << " bytes " << CHeap::GetNextLevel(*iter).fl << "/" << CHeap::GetNextLevel(*iter).sl << " instead of " << Level.fl << "/" << Level.sl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Same operations on a C heap and on a C++ heap handle give the same blocks
+const bool HeapHandleTest::testParity(void *address, unsigned long length)
+{
+  std::vector<void *> CBlocks;
+  std::vector<void *> TBlocks;
+  unsigned long HeapSize = length / 2;
+  unsigned long CBase = (unsigned long)address;
+  unsigned long TBase = CBase + HeapSize;
+
+  // The last quarter of each heap is a second pool
+  unsigned long PoolSize = HeapSize / 4;
+  memory_management_area_t * CArea = memory_heap_init((void *)CBase, HeapSize - PoolSize);
+  CHeap THeap = CHeap::Create((void *)TBase, HeapSize - PoolSize);
+  if((CArea == nullptr) || !THeap.IsValid())
+  {
+    GetError() << "Heap creation failed";
+    return false;
+  }
+  if(!memory_heap_add_pool(CArea, (void *)(CBase + HeapSize - PoolSize), PoolSize) ||
+     !THeap.AddPool((void *)(TBase + HeapSize - PoolSize), PoolSize))
+  {
+    GetError() << "Pool creation failed";
+    return false;
+  }
+
+  for(unsigned long Counter = 0; Counter < HANDLE_ITERATION; Counter++)
+  {
+    unsigned long Size = rand() % HANDLE_MAX_ALLOC;
+    void * TPtr;
+
+    // Constant size allocations have their level computed at compile time
+    switch(Counter % 4)
+    {
+      case 0:
+        Size = 24;
+        TPtr = THeap.Alloc<24>();
+        break;
+      case 1:
+        Size = 1000;
+        TPtr = THeap.Alloc<1000>();
+        break;
+      default:
+        TPtr = THeap.Alloc(Size);
+        break;
+    }
+    void * CPtr = memory_heap_alloc(CArea, Size);
+
+    if((CPtr == nullptr) != (TPtr == nullptr))
+    {
+      GetError() << "Allocation of " << Size << " differs at iteration " << Counter;
+      return false;
+    }
+    if(CPtr != nullptr)
+    {
+      if(memory_heap_owns(CArea, CPtr) != (unsigned long)THeap.Owns(TPtr))
+      {
+        GetError() << "Ownership of block " << TPtr << " differs";
+        return false;
+      }
+      if(((unsigned long)CPtr - CBase) != ((unsigned long)TPtr - TBase))
+      {
+        GetError() << "Block offset " << ((unsigned long)TPtr - TBase) << " instead of " << ((unsigned long)CPtr - CBase);
+        return false;
+      }
+      if(memory_usable_size(CPtr) != CHeap::UsableSize(TPtr))
+      {
+        GetError() << "Block size " << CHeap::UsableSize(TPtr) << " instead of " << memory_usable_size(CPtr);
+        return false;
+      }
+      CBlocks.push_back(CPtr);
+      TBlocks.push_back(TPtr);
+    }
+
+    if(!CBlocks.empty() && (rand() & 1))
+    {
+      unsigned long Index = rand() % CBlocks.size();
+      memory_heap_free(CArea, CBlocks[Index]);
+      THeap.Free(TBlocks[Index]);
+      CBlocks.erase(CBlocks.begin() + Index);
+      TBlocks.erase(TBlocks.begin() + Index);
+    }
+  }
+
+  memory_stats_t CStats;
+  memory_heap_get_stats(CArea, &CStats);
+  memory_stats_t TStats = THeap.GetStats();
+  if((CStats.alloc_count != TStats.alloc_count) || (CStats.free_count != TStats.free_count) || (CStats.used_size != TStats.used_size))
+  {
+    GetError() << "Statistics differ from memory.c";
+    return false;
+  }
+
+  for(unsigned long Index = 0; Index < CBlocks.size(); Index++)
+  {
+    memory_heap_free(CArea, CBlocks[Index]);
+    THeap.Free(TBlocks[Index]);
+  }
+  memory_heap_coalesce(CArea);
+  memory_heap_coalesce(THeap.GetArea());
+
+  // The bitmaps and the second pool must be the same
+  memory_management_area_t * TArea = THeap.GetArea();
+  if((CArea->first_level != TArea->first_level) || (CArea->fl_count != TArea->fl_count) ||
+     memcmp(MEMORY_SECOND_LEVEL(CArea), MEMORY_SECOND_LEVEL(TArea), CArea->fl_count * sizeof(unsigned long)) ||
+     !THeap.RemovePool((void *)(TBase + HeapSize - PoolSize)) || THeap.Owns((void *)(TBase + HeapSize - PoolSize)))
+  {
+    GetError() << "Heap control area differs from memory.c";
+    return false;
+  }
+  return true;
+}
+
+const bool HeapHandleTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  unsigned long * address = new unsigned long[HANDLE_HEAP_SIZE / sizeof(unsigned long)];
+
+  bool TestPass = testLevels();
+  if(TestPass)
+    TestPass = testParity(address, HANDLE_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,19 @@
+#ifndef HEAPHANDLETEST_H
+#define HEAPHANDLETEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class HeapHandleTest : public TestBase
+{
+  private:
+    const bool testLevels(void);
+    const bool testParity(void *address, unsigned long length);
+  public:
+    HeapHandleTest(const std::string testName) : TestBase(testName){}
+    ~HeapHandleTest(){}
+
+    const bool Execute(void);
+};
+
+#endif // HEAPHANDLETEST_H
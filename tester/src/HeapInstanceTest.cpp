@@ -0,0 +1,156 @@
+#include "HeapInstanceTest.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define HEAP_SIZE       (256 * 1024)
+#define HEAP_ITERATION  10000
+#define HEAP_MAX_ALLOC  (2048 + 1)
+
+const bool HeapInstanceTest::test(void *address, unsigned long length)
+{
+  MemoryBlockList ListOfBlocks[2];
+  unsigned long HeapSize = length / 2;
+
+  // Initialize two heaps side by side
+  for(unsigned Heap = 0; Heap < 2; Heap++)
+    m_managers[Heap].HeapInit((void *)((unsigned long)address + Heap * HeapSize), HeapSize);
+
+  for(unsigned long Counter = 0; Counter < HEAP_ITERATION; Counter++)
+  {
+    // Allocate alternately in each heap
+    unsigned Heap = Counter & 1;
+    MemoryBlock * CurrentBlock = m_managers[Heap].Alloc(rand() % HEAP_MAX_ALLOC);
+    if(CurrentBlock != nullptr)
+    {
+      // The block must be in the heap area
+      unsigned long Start = (unsigned long)address + Heap * HeapSize;
+      unsigned long BlockAddress = (unsigned long)CurrentBlock->GetAddress();
+      if((BlockAddress < Start) || ((BlockAddress + CurrentBlock->GetSize()) > (Start + HeapSize)))
+      {
+        GetError() << "Block " << CurrentBlock->GetAddress() << " allocated outside of heap " << Heap;
+        return false;
+      }
+      ListOfBlocks[Heap].push_back(CurrentBlock);
+    }
+
+    // Free randomly in the other heap
+    MemoryBlockList & Other = ListOfBlocks[Heap ^ 1];
+    if(!Other.empty() && (rand() & 1))
+    {
+      MemoryBlockList::iterator iter = Other.begin() + (rand() % Other.size());
+      m_managers[Heap ^ 1].Free(*iter);
+      Other.erase(iter);
+    }
+  }
+
+  for(unsigned Heap = 0; Heap < 2; Heap++)
+  {
+    // Free the rest of allocated block
+    for(MemoryBlockList::iterator iter = ListOfBlocks[Heap].begin(); iter != ListOfBlocks[Heap].end(); iter++)
+      m_managers[Heap].Free(*iter);
+
+    // Check the memory integrity
+    if(m_managers[Heap].CheckInitalMemory() == false)
+    {
+      GetError() << "Heap " << Heap << " : " << m_managers[Heap].GetError().str();
+      return false;
+    }
+  }
+  return true;
+}
+
+#if MEMORY_OFFSET_LINKS
+// A heap with offset links is used again after a copy at an other address
+const bool HeapInstanceTest::testMove(void *address, unsigned long length)
+{
+  std::vector<unsigned long> Offsets;
+  unsigned long HeapSize = length / 2;
+  unsigned long Source = (unsigned long)address;
+  unsigned long Target = Source + HeapSize;
+
+  // Reference of the empty heap at the target address
+  m_managers[0].HeapInit((void *)Target, HeapSize);
+  memory_management_area_t * Heap = memory_heap_init((void *)Source, HeapSize);
+  for(unsigned long Counter = 0; Counter < HEAP_ITERATION; Counter++)
+  {
+    unsigned long Size = rand() % HEAP_MAX_ALLOC;
+    unsigned char * Ptr = (unsigned char *)memory_heap_alloc(Heap, Size);
+    if(Ptr != nullptr)
+    {
+      memset(Ptr, (unsigned char)((unsigned long)Ptr - Source), memory_usable_size(Ptr));
+      Offsets.push_back((unsigned long)Ptr - Source);
+    }
+    if(!Offsets.empty() && (rand() & 1))
+    {
+      unsigned long Index = rand() % Offsets.size();
+      memory_heap_free(Heap, (void *)(Source + Offsets[Index]));
+      Offsets[Index] = Offsets.back();
+      Offsets.pop_back();
+    }
+  }
+
+  // Move the heap and wipe the old area
+  memcpy((void *)Target, (void *)Source, HeapSize);
+  memset((void *)Source, 0xDD, HeapSize);
+  Heap = (memory_management_area_t *)Target;
+  if(!memory_heap_owns(Heap, (void *)(Target + HeapSize - 1)) || memory_heap_owns(Heap, (void *)Source))
+  {
+    GetError() << "Moved heap owns the old area";
+    return false;
+  }
+
+  // The blocks are found at the same offsets and the heap goes on
+  for(std::vector<unsigned long>::iterator iter = Offsets.begin(); iter != Offsets.end(); iter++)
+  {
+    unsigned char * Ptr = (unsigned char *)(Target + *iter);
+    for(unsigned long i = 0; i < memory_usable_size(Ptr); i++)
+    {
+      if(Ptr[i] != (unsigned char)*iter)
+      {
+        GetError() << "Moved block " << (void *)Ptr << " overwritten at offset " << i;
+        return false;
+      }
+    }
+  }
+  for(unsigned long Counter = 0; Counter < HEAP_ITERATION; Counter++)
+  {
+    unsigned char * Ptr = (unsigned char *)memory_heap_alloc(Heap, rand() % HEAP_MAX_ALLOC);
+    if(Ptr != nullptr)
+    {
+      if(((unsigned long)Ptr < Target) || ((unsigned long)Ptr + memory_usable_size(Ptr) > Target + HeapSize))
+      {
+        GetError() << "Block " << (void *)Ptr << " allocated outside of the moved heap";
+        return false;
+      }
+      memory_heap_free(Heap, Ptr);
+    }
+  }
+  for(std::vector<unsigned long>::iterator iter = Offsets.begin(); iter != Offsets.end(); iter++)
+    memory_heap_free(Heap, (void *)(Target + *iter));
+
+  if(m_managers[0].CheckInitalMemory() == false)
+  {
+    GetError() << "Moved heap : " << m_managers[0].GetError().str();
+    return false;
+  }
+  return true;
+}
+#endif /* MEMORY_OFFSET_LINKS */
+
+const bool HeapInstanceTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[2 * HEAP_SIZE];
+
+  bool TestPass = test(address, 2 * HEAP_SIZE);
+#if MEMORY_OFFSET_LINKS
+  if(TestPass)
+    TestPass = testMove(address, 2 * HEAP_SIZE);
+#endif /* MEMORY_OFFSET_LINKS */
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,24 @@
+#ifndef HEAPINSTANCETEST_H
+#define HEAPINSTANCETEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class HeapInstanceTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+#if MEMORY_OFFSET_LINKS
+    const bool testMove(void *address, unsigned long length);
+#endif /* MEMORY_OFFSET_LINKS */
+  public:
+    HeapInstanceTest(const std::string testName) : TestBase(testName){}
+    ~HeapInstanceTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_managers[2];
+};
+
+#endif // HEAPINSTANCETEST_H
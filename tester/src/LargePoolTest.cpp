@@ -0,0 +1,110 @@
+#include "LargePoolTest.h"
+#include <cstdlib>
+#include <vector>
+#include <sys/mman.h>
+
+#define GIB                     (1024UL * 1024UL * 1024UL)
+#define LARGE_POOL_ITERATION    20000
+#define LARGE_POOL_MAX_ALLOC    (64UL * 1024UL * 1024UL)
+
+const bool LargePoolTest::CheckBlock(void * ptr, unsigned long size, void *address, unsigned long length)
+{
+  if(ptr == nullptr)
+  {
+    GetError() << "Allocation of " << size << " bytes failed";
+    return false;
+  }
+  if(((unsigned long)ptr < (unsigned long)address) || ((unsigned long)ptr + size > (unsigned long)address + length))
+  {
+    GetError() << "Block " << ptr << " of " << size << " bytes outside of the pool";
+    return false;
+  }
+  // Touch both ends of the block
+  ((unsigned char *)ptr)[0] = 0xAA;
+  ((unsigned char *)ptr)[size - 1] = 0x55;
+  return true;
+}
+
+const bool LargePoolTest::test(void *address, unsigned long length)
+{
+  std::vector<void *> Blocks;
+
+  m_manager.HeapInit(address, length);
+
+  // Blocks over 4 GiB and around the 32 bits limits
+  const unsigned long Sizes[] = {(5 * GIB) / 2, GIB, GIB + 4096, 4 * GIB + 8};
+  void * Big[3];
+  for(unsigned i = 0; i < 3; i++)
+  {
+    Big[i] = memory_heap_alloc(m_manager.GetHeap(), Sizes[i]);
+    if(!CheckBlock(Big[i], Sizes[i], address, length))
+      return false;
+  }
+  for(unsigned i = 0; i < 3; i++)
+    memory_heap_free(m_manager.GetHeap(), Big[i]);
+  void * Huge = memory_heap_alloc(m_manager.GetHeap(), Sizes[3]);
+  if(!CheckBlock(Huge, Sizes[3], address, length))
+    return false;
+  memory_heap_free(m_manager.GetHeap(), Huge);
+
+  // Random allocations spread over the whole pool
+  for(unsigned long Counter = 0; Counter < LARGE_POOL_ITERATION; Counter++)
+  {
+    unsigned long Size = 1 + ((unsigned long)rand() * rand()) % LARGE_POOL_MAX_ALLOC;
+    void * ptr = memory_heap_alloc(m_manager.GetHeap(), Size);
+    if(ptr != nullptr)
+    {
+      if(!CheckBlock(ptr, Size, address, length))
+        return false;
+      Blocks.push_back(ptr);
+    }
+    if(!Blocks.empty() && (rand() % 3 == 0))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      memory_heap_free(m_manager.GetHeap(), *iter);
+      Blocks.erase(iter);
+    }
+  }
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_heap_free(m_manager.GetHeap(), *iter);
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool LargePoolTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  if(sizeof(unsigned long) < 8)
+  {
+    std::cout << "Skipped, needs 64 bits words" << std::endl;
+    return true;
+  }
+
+  // Only the touched pages get memory
+  unsigned long length = 6 * GIB;
+  void * address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if(address == MAP_FAILED)
+  {
+    std::cout << "Skipped, can't reserve " << length << " bytes" << std::endl;
+    return true;
+  }
+
+#if MEMORY_OFFSET_LINKS
+  // The blocks of a pool over 4 GiB do not fit the offset links
+  bool TestPass = (memory_heap_init(address, length) == nullptr);
+  if(!TestPass)
+    GetError() << "Pool of " << length << " bytes accepted with the offset links";
+#else
+  bool TestPass = test(address, length);
+#endif /* MEMORY_OFFSET_LINKS */
+  munmap(address, length);
+  return TestPass;
+}
@@ -0,0 +1,22 @@
+#ifndef LARGEPOOLTEST_H
+#define LARGEPOOLTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class LargePoolTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+    const bool CheckBlock(void * ptr, unsigned long size, void *address, unsigned long length);
+  public:
+    LargePoolTest(const std::string testName) : TestBase(testName){}
+    ~LargePoolTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // LARGEPOOLTEST_H
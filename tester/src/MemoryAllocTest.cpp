@@ -1,5 +1,9 @@
 #include "MemoryAllocTest.h"
 #include "bitwise.h"
+#include <cstdlib>
+
+// Seed of the random workload, FMA32_SEED replaces it to try another workload
+#define MEMORY_ALLOC_TEST_SEED    1
 
 struct MemoryInformation {
   unsigned long MemSize;
@@ -14,7 +18,13 @@ const struct MemoryInformation MemInfo[4] = {{        8 * 1024,    1000000,
                                     
 const bool MemoryAllocTest::test(void *address, unsigned long length)
 {
-  srand(time(NULL));
+  unsigned long Seed = MEMORY_ALLOC_TEST_SEED;
+  const char * SeedEnv = getenv("FMA32_SEED");
+
+  if(SeedEnv != nullptr)
+    Seed = strtoul(SeedEnv, nullptr, 0);
+  std::cout << "Random seed : " << Seed << std::endl;
+  srand(Seed);
   
   for(unsigned MemIter = 0; MemIter < 4; MemIter++)
   {
@@ -53,6 +63,14 @@ const bool MemoryAllocTest::test(void *address, unsigned long length)
       }
     }
     
+    // Check the links between the blocks
+    if(m_manager.CheckBlocks() == false)
+    {
+      std::stringstream & err = GetError();
+      err << m_manager.GetError().str();
+      return false;
+    }
+
     // Free the rest of allocated block
     for(MemoryBlockList::iterator iter = ListOfBlocks.begin(); iter != ListOfBlocks.end(); iter++)
     {
@@ -0,0 +1,135 @@
+#include "OrderTest.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+extern "C" void block_get_levels(unsigned long size, memory_level_t *level);
+
+#define ORDER_HEAP_SIZE     (256 * 1024)
+#define ORDER_BLOCK_COUNT   64
+#define ORDER_ITERATION     20000
+#define ORDER_MAX_ALLOC     4096
+// First size of its second level, the allocations of ORDER_REQUEST take its list
+#define ORDER_BLOCK_SIZE    1008
+#define ORDER_REQUEST       1000
+
+// The blocks of every free list must be sorted by address
+static const bool CheckOrder(memory_management_area_t * Heap, std::stringstream & Error)
+{
+  for(unsigned long fl = 0; fl < Heap->fl_count; fl++)
+  {
+    for(unsigned long sl = 0; sl < MEMORY_SL_COUNT; sl++)
+    {
+      memory_block_t * Prev = nullptr;
+      for(memory_link_t Link = MEMORY_FBLA(Heap)[fl][sl]; Link != BLOCK_NO_LINK; Link = BLOCK_FROM_LINK(Heap, Link)->next)
+      {
+        memory_block_t * Block = BLOCK_FROM_LINK(Heap, Link);
+        if((Prev != nullptr) && (Block < Prev))
+        {
+          Error << "Free block " << Block << " after " << Prev << " in the list " << fl << "/" << sl;
+          return false;
+        }
+        Prev = Block;
+      }
+    }
+  }
+  return true;
+}
+
+const bool OrderTest::test(void *address, unsigned long length)
+{
+  std::vector<void *> Blocks;
+  std::vector<void *> Guards;
+  memory_level_t Level;
+
+  m_manager.MemoryInit(address, length);
+  memory_management_area_t * Heap = m_manager.GetHeap();
+  // The freed blocks go to the free lists at once
+  memory_set_defer_limit(0);
+
+  // Blocks of the same size between used blocks, freed in a random order
+  for(unsigned long Counter = 0; Counter < ORDER_BLOCK_COUNT; Counter++)
+  {
+    Blocks.push_back(memory_alloc(ORDER_BLOCK_SIZE));
+    Guards.push_back(memory_alloc(64));
+  }
+  std::vector<void *> Freed(Blocks);
+  for(unsigned long Counter = Freed.size() - 1; Counter > 0; Counter--)
+    std::swap(Freed[Counter], Freed[rand() % (Counter + 1)]);
+  for(std::vector<void *>::iterator iter = Freed.begin(); iter != Freed.end(); iter++)
+    memory_free(*iter);
+
+  block_get_levels(ORDER_BLOCK_SIZE, &Level);
+  unsigned long Count = 0;
+  for(memory_link_t Link = MEMORY_FBLA(Heap)[Level.fl][Level.sl]; Link != BLOCK_NO_LINK; Link = BLOCK_FROM_LINK(Heap, Link)->next)
+    Count++;
+  if((Count != ORDER_BLOCK_COUNT) || !CheckOrder(Heap, GetError()))
+  {
+    GetError() << " (" << Count << " free blocks of " << ORDER_BLOCK_SIZE << " bytes)";
+    return false;
+  }
+
+  // The allocations take the blocks from the lowest address
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+  {
+    void * Ptr = memory_alloc(ORDER_REQUEST);
+    if(Ptr != *iter)
+    {
+      GetError() << "Allocation at " << Ptr << " instead of the lowest free block " << *iter;
+      return false;
+    }
+  }
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(*iter);
+  for(std::vector<void *>::iterator iter = Guards.begin(); iter != Guards.end(); iter++)
+    memory_free(*iter);
+  Blocks.clear();
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+
+  // Random workload, the lists stay sorted
+  for(unsigned long Counter = 0; Counter < ORDER_ITERATION; Counter++)
+  {
+    void * Ptr = memory_alloc(1 + rand() % ORDER_MAX_ALLOC);
+    if(Ptr != nullptr)
+      Blocks.push_back(Ptr);
+    if(!Blocks.empty() && (rand() & 1))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      memory_free(*iter);
+      Blocks.erase(iter);
+    }
+  }
+  if(!CheckOrder(Heap, GetError()))
+    return false;
+  if(m_manager.CheckBlocks() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(*iter);
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool OrderTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[ORDER_HEAP_SIZE];
+
+  bool TestPass = test(address, ORDER_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,21 @@
+#ifndef ORDERTEST_H
+#define ORDERTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class OrderTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    OrderTest(const std::string testName) : TestBase(testName){}
+    ~OrderTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // ORDERTEST_H
@@ -0,0 +1,223 @@
+#include "OsPoolTest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define OS_POOL_SIZE        (8UL * 1024UL * 1024UL + 1)
+#define OS_POOL_PREFAULT    (64UL * 1024UL)
+#define OS_POOL_ITERATION   20000
+#define OS_POOL_MAX_ALLOC   (16 * 1024 + 1)
+#define OS_POOL_MODE_FILE   "OsPoolTest.mode"
+#define OS_POOL_MODE_SYSTEM "/sys/kernel/mm/transparent_hugepage/enabled"
+
+extern "C" unsigned long os_transparent_enabled(const char * path);
+
+static const char * const PageNames[] = {"normal", "transparent huge", "explicit huge"};
+
+const bool OsPoolTest::CheckPool(memory_os_pool_t & pool, unsigned long length, unsigned long pages)
+{
+  unsigned long page = (unsigned long)sysconf(_SC_PAGESIZE);
+
+  std::cout << "Asked " << PageNames[pages] << " pages, got " << PageNames[pool.pages] << " pages" << std::endl;
+
+  // A policy falls back only to the ones below it
+  if((pool.address == nullptr) || (pool.length < length) || (pool.pages > pages))
+  {
+    GetError() << "Pool " << pool.address << " of " << pool.length << " bytes with the page policy " << pool.pages;
+    return false;
+  }
+  if((pool.pages != MEMORY_OS_PAGES_NORMAL) && (((unsigned long)pool.address & (MEMORY_OS_HUGE_PAGE_SIZE - 1)) != 0))
+  {
+    GetError() << "Huge page pool " << pool.address << " not aligned";
+    return false;
+  }
+
+  // The prefaulted pages are resident
+  unsigned long count = OS_POOL_PREFAULT / page;
+  std::vector<unsigned char> Resident(count);
+  if(mincore(pool.address, OS_POOL_PREFAULT, Resident.data()) != 0)
+  {
+    GetError() << "Residency of the pool unknown";
+    return false;
+  }
+  for(unsigned long i = 0; i < count; i++)
+  {
+    if((Resident[i] & 1) == 0)
+    {
+      GetError() << "Page " << i << " of the pool not prefaulted";
+      return false;
+    }
+  }
+  return true;
+}
+
+const bool OsPoolTest::testPages(unsigned long pages)
+{
+  memory_os_pool_t pool;
+  std::vector<MemoryBlock *> Blocks;
+
+  if(!memory_os_reserve(&pool, OS_POOL_SIZE, pages, OS_POOL_PREFAULT))
+  {
+    GetError() << "Pool of " << OS_POOL_SIZE << " bytes not reserved";
+    return false;
+  }
+  if(!CheckPool(pool, OS_POOL_SIZE, pages))
+  {
+    memory_os_release(&pool);
+    return false;
+  }
+
+  m_manager.HeapInit(pool.address, pool.length);
+  for(unsigned long Counter = 0; Counter < OS_POOL_ITERATION; Counter++)
+  {
+    MemoryBlock * block = m_manager.Alloc(rand() % OS_POOL_MAX_ALLOC);
+    if(block != nullptr)
+      Blocks.push_back(block);
+    if(!Blocks.empty() && (rand() % 3 == 0))
+    {
+      std::vector<MemoryBlock *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      m_manager.Free(*iter);
+      Blocks.erase(iter);
+    }
+  }
+  for(std::vector<MemoryBlock *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    m_manager.Free(*iter);
+
+  bool TestPass = m_manager.CheckInitalMemory();
+  if(!TestPass)
+    GetError() << m_manager.GetError().str();
+  memory_os_release(&pool);
+  if(pool.address != nullptr)
+  {
+    GetError() << "Released pool still set";
+    return false;
+  }
+  return TestPass;
+}
+
+// A heap in a pool of the system, grown by a second one
+const bool OsPoolTest::testHeap(void)
+{
+  memory_os_pool_t pool;
+  memory_os_pool_t added;
+
+  memory_management_area_t * heap = memory_os_heap_init(&pool, OS_POOL_SIZE, MEMORY_OS_PAGES_TRANSPARENT, OS_POOL_PREFAULT);
+  if(heap == nullptr)
+  {
+    GetError() << "Heap not initialized in a pool of the system";
+    return false;
+  }
+  m_manager.HeapAttach(heap);
+
+  // Bigger than the free space of the first pool
+  unsigned long Size = (pool.length / 4) * 3;
+  void * First = memory_heap_alloc(heap, Size);
+  void * Second = memory_heap_alloc(heap, Size);
+  if((First == nullptr) || (Second != nullptr))
+  {
+    GetError() << "First pool of " << pool.length << " bytes gave " << First << " and " << Second;
+    return false;
+  }
+  if(!memory_os_add_pool(heap, &added, OS_POOL_SIZE, MEMORY_OS_PAGES_NORMAL, 0))
+  {
+    GetError() << "Pool of the system not added";
+    return false;
+  }
+  Second = memory_heap_alloc(heap, Size);
+  if((Second == nullptr) || !memory_heap_owns(heap, Second) || ((unsigned long)Second < (unsigned long)added.address) ||
+     ((unsigned long)Second + Size > (unsigned long)added.address + added.length))
+  {
+    GetError() << "Block " << Second << " not in the added pool";
+    return false;
+  }
+  memset(First, 0xAA, Size);
+  memset(Second, 0x55, Size);
+  memory_heap_free(heap, Second);
+  memory_heap_free(heap, First);
+
+  if(!memory_heap_remove_pool(heap, added.address))
+  {
+    GetError() << "Pool of the system not removed";
+    return false;
+  }
+  memory_os_release(&added);
+
+  bool TestPass = m_manager.CheckInitalMemory();
+  if(!TestPass)
+    GetError() << m_manager.GetError().str();
+  memory_os_release(&pool);
+  return TestPass;
+}
+
+// The pool has transparent huge pages only when the mode of the system gives them
+const bool OsPoolTest::testTransparentMode(void)
+{
+  const char * const Modes[] = {"[always] madvise never\n", "always [madvise] never\n", "always madvise [never]\n", ""};
+  const unsigned long Enabled[] = {1, 1, 0, 0};
+
+  for(unsigned i = 0; i < sizeof(Modes) / sizeof(Modes[0]); i++)
+  {
+    FILE * File = fopen(OS_POOL_MODE_FILE, "w");
+    if(File == nullptr)
+    {
+      GetError() << "Mode file " << OS_POOL_MODE_FILE << " can not be created";
+      return false;
+    }
+    fputs(Modes[i], File);
+    fclose(File);
+    unsigned long Result = os_transparent_enabled(OS_POOL_MODE_FILE);
+    remove(OS_POOL_MODE_FILE);
+    if(Result != Enabled[i])
+    {
+      GetError() << "Transparent huge pages " << (Result ? "enabled" : "disabled") << " by the mode " << Modes[i];
+      return false;
+    }
+  }
+  if(os_transparent_enabled("OsPoolTest.none") != 0)
+  {
+    GetError() << "Transparent huge pages enabled without mode";
+    return false;
+  }
+
+  memory_os_pool_t pool;
+  if(!memory_os_reserve(&pool, OS_POOL_SIZE, MEMORY_OS_PAGES_TRANSPARENT, 0))
+  {
+    GetError() << "Pool of " << OS_POOL_SIZE << " bytes not reserved";
+    return false;
+  }
+  bool Transparent = (pool.pages == MEMORY_OS_PAGES_TRANSPARENT);
+  memory_os_release(&pool);
+  if(Transparent && !os_transparent_enabled(OS_POOL_MODE_SYSTEM))
+  {
+    GetError() << "Transparent huge pages reported while the system mode is never";
+    return false;
+  }
+  return true;
+}
+
+const bool OsPoolTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  memory_os_pool_t pool;
+  if(memory_os_reserve(&pool, 0, MEMORY_OS_PAGES_NORMAL, 0))
+  {
+    GetError() << "Empty pool reserved";
+    return false;
+  }
+
+  if(!testTransparentMode())
+    return false;
+
+  for(unsigned long pages = MEMORY_OS_PAGES_NORMAL; pages <= MEMORY_OS_PAGES_EXPLICIT; pages++)
+  {
+    if(!testPages(pages))
+      return false;
+  }
+  return testHeap();
+}
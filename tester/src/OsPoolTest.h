@@ -0,0 +1,25 @@
+#ifndef OSPOOLTEST_H
+#define OSPOOLTEST_H
+
+#include "Blocks.h"
+#include "memory_os.h"
+#include "test.h"
+
+class OsPoolTest : public TestBase
+{
+  private:
+    const bool testPages(unsigned long pages);
+    const bool testHeap(void);
+    const bool testTransparentMode(void);
+    const bool CheckPool(memory_os_pool_t & pool, unsigned long length, unsigned long pages);
+  public:
+    OsPoolTest(const std::string testName) : TestBase(testName){}
+    ~OsPoolTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // OSPOOLTEST_H
@@ -0,0 +1,182 @@
+#include "PoolTest.h"
+#include "bitwise.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define POOL_SIZE           (64 * 1024)
+#define POOL_COUNT          3
+#define POOL_ITERATION      50000
+#define POOL_MAX_ALLOC      (1024 + 1)
+
+struct PoolBlock {
+  unsigned char * Address;
+  unsigned long Size;
+  unsigned char Pattern;
+};
+
+// The pools are side by side, blocks must never be merged across them
+const bool PoolTest::test(void *address, unsigned long length)
+{
+  std::vector<PoolBlock> Blocks;
+  unsigned long PoolSize = length / POOL_COUNT;
+  unsigned long InPool[POOL_COUNT] = {0};
+
+  m_manager.MemoryInit(address, PoolSize);
+  for(unsigned Pool = 1; Pool < POOL_COUNT; Pool++)
+  {
+    if(!memory_add_pool((void *)((unsigned long)address + Pool * PoolSize), PoolSize))
+    {
+      GetError() << "Pool " << Pool << " not added";
+      return false;
+    }
+  }
+
+  // Overlapping pools and pools bigger than the levels of the heap are refused
+  if(memory_add_pool((void *)((unsigned long)address + PoolSize / 2), PoolSize))
+  {
+    GetError() << "Overlapping pool added";
+    return false;
+  }
+  unsigned char * Big = new unsigned char[64 * PoolSize];
+  if(memory_add_pool(Big, 64 * PoolSize))
+  {
+    GetError() << "Pool bigger than the heap levels added";
+    return false;
+  }
+  delete [] Big;
+
+  // The free block of a pool must be under the limit of the first pool levels
+  memory_management_area_t * Heap = (memory_management_area_t *)RESIZE_UP(address, LONG_SIZE_BYTE);
+  unsigned long Limit = MEMORY_POOL_LIMIT(Heap);
+  if(Limit != bit_next_power_of_two(PoolSize))
+  {
+    GetError() << "Pool limit " << Limit << " for a first pool of " << PoolSize << " bytes";
+    return false;
+  }
+  unsigned long Length = RESIZE_UP(Limit + BLOCK_HEADER_SIZE_USED, MEMORY_CHUNK_ALIGN);
+  Big = new unsigned char[Length + MEMORY_CHUNK_ALIGN];
+  void * Start = BLOCK_ALIGN_START(Big);
+  if(memory_add_pool(Start, Length))
+  {
+    GetError() << "Pool with a free block of " << Length - BLOCK_HEADER_SIZE_USED << " bytes added";
+    return false;
+  }
+  if(!memory_add_pool(Start, Length - LONG_SIZE_BYTE) || !memory_remove_pool(Start))
+  {
+    GetError() << "Pool of " << Length - LONG_SIZE_BYTE << " bytes refused";
+    return false;
+  }
+  delete [] Big;
+
+  if(memory_owns((void *)((unsigned long)address + length)) || memory_owns((void *)((unsigned long)address - 1)))
+  {
+    GetError() << "Memory outside of the pools owned";
+    return false;
+  }
+
+  // The registry is read without the heap lock
+  memory_lock();
+  bool Owned = memory_owns((void *)((unsigned long)address + (POOL_COUNT - 1) * PoolSize + LONG_SIZE_BYTE));
+  memory_unlock();
+  if(!Owned)
+  {
+    GetError() << "Memory of the last pool not owned under the heap lock";
+    return false;
+  }
+
+  for(unsigned long Counter = 0; Counter < POOL_ITERATION; Counter++)
+  {
+    PoolBlock Block = {nullptr, (unsigned long)(rand() % POOL_MAX_ALLOC), (unsigned char)Counter};
+
+    Block.Address = (unsigned char *)memory_alloc(Block.Size);
+    if(Block.Address != nullptr)
+    {
+      // The block must be entirely in one pool
+      unsigned long Pool = ((unsigned long)Block.Address - (unsigned long)address) / PoolSize;
+      unsigned long End = (unsigned long)Block.Address + memory_usable_size(Block.Address);
+      if((Pool >= POOL_COUNT) || (End > (unsigned long)address + (Pool + 1) * PoolSize) || !memory_owns(Block.Address))
+      {
+        GetError() << "Block " << (void *)Block.Address << " across pools";
+        return false;
+      }
+      InPool[Pool]++;
+      memset(Block.Address, Block.Pattern, Block.Size);
+      Blocks.push_back(Block);
+    }
+
+    if(!Blocks.empty() && ((rand() % 3) == 0))
+    {
+      std::vector<PoolBlock>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      for(unsigned long i = 0; i < iter->Size; i++)
+      {
+        if(iter->Address[i] != iter->Pattern)
+        {
+          GetError() << "Block " << (void *)iter->Address << " overwritten at offset " << i;
+          return false;
+        }
+      }
+      memory_free(iter->Address);
+      Blocks.erase(iter);
+    }
+  }
+
+  for(unsigned Pool = 0; Pool < POOL_COUNT; Pool++)
+  {
+    if(InPool[Pool] == 0)
+    {
+      GetError() << "No block allocated in pool " << Pool;
+      return false;
+    }
+  }
+
+  // A pool in use can not be removed
+  if(!Blocks.empty())
+  {
+    unsigned long Pool = ((unsigned long)Blocks[0].Address - (unsigned long)address) / PoolSize;
+    if((Pool != 0) && memory_remove_pool((void *)((unsigned long)address + Pool * PoolSize)))
+    {
+      GetError() << "Pool " << Pool << " in use removed";
+      return false;
+    }
+  }
+
+  for(std::vector<PoolBlock>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(iter->Address);
+
+  // The first pool stays, the others are entirely free
+  if(memory_remove_pool(address))
+  {
+    GetError() << "First pool removed";
+    return false;
+  }
+  for(unsigned Pool = 1; Pool < POOL_COUNT; Pool++)
+  {
+    void * PoolAddress = (void *)((unsigned long)address + Pool * PoolSize);
+    if(!memory_remove_pool(PoolAddress) || memory_owns(PoolAddress))
+    {
+      GetError() << "Pool " << Pool << " not removed";
+      return false;
+    }
+  }
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool PoolTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[POOL_COUNT * POOL_SIZE];
+
+  bool TestPass = test(address, POOL_COUNT * POOL_SIZE);
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,21 @@
+#ifndef POOLTEST_H
+#define POOLTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class PoolTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    PoolTest(const std::string testName) : TestBase(testName){}
+    ~PoolTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // POOLTEST_H
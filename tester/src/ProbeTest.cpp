@@ -0,0 +1,97 @@
+#include "ProbeTest.h"
+#include <cstdlib>
+#include <vector>
+
+#define PROBE_HEAP_SIZE     (256 * 1024)
+#define PROBE_ITERATION     20000
+#define PROBE_MAX_ALLOC     (2048 + 1)
+
+const bool ProbeTest::test(void *address, unsigned long length)
+{
+  std::vector<void *> Blocks;
+  unsigned long AllocCount = 0;
+  unsigned long FailCount = 0;
+  unsigned long FreeCount = 0;
+  memory_probes_t Probes;
+
+  m_manager.MemoryInit(address, length);
+  // Every free merges now and every allocation searches, as the counts below expect
+  memory_set_defer_limit(0);
+  memory_set_fit_scan(0);
+  memory_reset_probes();
+
+  for(unsigned long Counter = 0; Counter < PROBE_ITERATION; Counter++)
+  {
+    void * Ptr = memory_alloc(rand() % PROBE_MAX_ALLOC);
+    if(Ptr != nullptr)
+    {
+      AllocCount++;
+      Blocks.push_back(Ptr);
+    }
+    else
+    {
+      FailCount++;
+    }
+
+    if(!Blocks.empty() && (rand() & 1))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      FreeCount++;
+      memory_free(*iter);
+      Blocks.erase(iter);
+    }
+  }
+
+  // One search and one split by allocation, one coalescing case by free
+  memory_get_probes(&Probes);
+  if((Probes.find.count != AllocCount + FailCount) || (Probes.find_failed != FailCount) || (Probes.split.count != AllocCount))
+  {
+    GetError() << "Probes count " << Probes.find.count << " searches " << Probes.find_failed << " failed "
+               << Probes.split.count << " splits for " << AllocCount << " allocations and " << FailCount << " failures";
+    return false;
+  }
+  if((Probes.merge_left.count != FreeCount) || (Probes.merge_right.count != FreeCount) ||
+     (Probes.coalesce_none + Probes.coalesce_left + Probes.coalesce_right + Probes.coalesce_both != FreeCount))
+  {
+    GetError() << "Probes count " << Probes.merge_left.count << " left merges " << Probes.merge_right.count
+               << " right merges for " << FreeCount << " frees";
+    return false;
+  }
+  if((Probes.split_refused > Probes.split.count) || (Probes.find_escalated > Probes.find.count) ||
+     (Probes.insert.count == 0) || (Probes.find.cycles == 0))
+  {
+    GetError() << "Probes counters out of range";
+    return false;
+  }
+
+  memory_reset_probes();
+  memory_get_probes(&Probes);
+  if((Probes.find.count != 0) || (Probes.coalesce_none != 0))
+  {
+    GetError() << "Probes not reset";
+    return false;
+  }
+
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(*iter);
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool ProbeTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[PROBE_HEAP_SIZE];
+
+  bool TestPass = test(address, PROBE_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
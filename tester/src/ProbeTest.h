@@ -0,0 +1,21 @@
+#ifndef PROBETEST_H
+#define PROBETEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class ProbeTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    ProbeTest(const std::string testName) : TestBase(testName){}
+    ~ProbeTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // PROBETEST_H
@@ -0,0 +1,102 @@
+#include "ReallocTest.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define REALLOC_HEAP_SIZE   (1024 * 1024)
+#define REALLOC_ITERATION   100000
+#define REALLOC_MAX_SIZE    (8192 + 1)
+#define REALLOC_BLOCKS      64
+
+struct ReallocBlock {
+  unsigned char * Address;
+  unsigned long Size;
+  unsigned char Pattern;
+};
+
+const bool ReallocTest::test(void *address, unsigned long length)
+{
+  ReallocBlock Blocks[REALLOC_BLOCKS];
+  unsigned long InPlace = 0;
+  unsigned long Moved = 0;
+
+  m_manager.MemoryInit(address, length);
+  memset(Blocks, 0, sizeof(Blocks));
+
+  for(unsigned long Counter = 0; Counter < REALLOC_ITERATION; Counter++)
+  {
+    ReallocBlock & Block = Blocks[rand() % REALLOC_BLOCKS];
+    unsigned long Size = rand() % REALLOC_MAX_SIZE;
+
+    unsigned char * ptr = (unsigned char *)memory_realloc(Block.Address, Size);
+    if((ptr == nullptr) && (Size != 0))
+      continue;
+    if((Block.Address != nullptr) && (ptr != nullptr))
+      (ptr == Block.Address) ? InPlace++ : Moved++;
+    if((ptr != nullptr) && (memory_usable_size(ptr) < Size))
+    {
+      GetError() << "Block " << (void *)ptr << " too small for " << Size << " bytes";
+      return false;
+    }
+
+    // The content must be kept up to the smallest size
+    for(unsigned long i = 0; (i < Block.Size) && (i < Size); i++)
+    {
+      if(ptr[i] != Block.Pattern)
+      {
+        GetError() << "Block " << (void *)ptr << " content lost at offset " << i;
+        return false;
+      }
+    }
+
+    // Fill the whole block with a new pattern
+    Block.Address = ptr;
+    Block.Size = Size;
+    Block.Pattern = (unsigned char)Counter;
+    if(ptr != nullptr)
+      memset(ptr, Block.Pattern, Size);
+  }
+
+  // Sizes whose rounding wraps around are refused and the block is kept
+  unsigned char * ptr = (unsigned char *)memory_alloc(64);
+  if(ptr == nullptr)
+  {
+    GetError() << "Allocation of 64 bytes failed";
+    return false;
+  }
+  unsigned long Usable = memory_usable_size(ptr);
+  const unsigned long Huge[] = {(unsigned long)-1, (unsigned long)-3, (unsigned long)-(2 * REALLOC_HEAP_SIZE)};
+  for(unsigned i = 0; i < sizeof(Huge) / sizeof(Huge[0]); i++)
+  {
+    if(memory_try_expand(ptr, Huge[i]) || (memory_realloc(ptr, Huge[i]) != nullptr) || (memory_usable_size(ptr) != Usable))
+    {
+      GetError() << "Block " << (void *)ptr << " resized to " << Huge[i] << " bytes";
+      return false;
+    }
+  }
+  memory_free(ptr);
+
+  for(unsigned Index = 0; Index < REALLOC_BLOCKS; Index++)
+    memory_realloc(Blocks[Index].Address, 0);
+
+  std::cout << "Resized in place : " << InPlace << "    moved : " << Moved << std::endl;
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool ReallocTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[REALLOC_HEAP_SIZE];
+
+  bool TestPass = test(address, REALLOC_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,21 @@
+#ifndef REALLOCTEST_H
+#define REALLOCTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class ReallocTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    ReallocTest(const std::string testName) : TestBase(testName){}
+    ~ReallocTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // REALLOCTEST_H
@@ -0,0 +1,147 @@
+#include "ResourceTest.h"
+#include "memory_resource.hpp"
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define RESOURCE_HEAP_SIZE    (8 * 1024 * 1024)
+#define RESOURCE_COUNT        10000
+
+struct alignas(64) AlignedItem {
+  unsigned char Bytes[64];
+};
+
+// Every chunk of a container must be in its heap
+template<typename Iterator>
+static const bool InHeap(memory_management_area_t * Heap, Iterator First, Iterator Last)
+{
+  for(; First != Last; First++)
+  {
+    if(!memory_heap_owns(Heap, (void *)&*First))
+      return false;
+  }
+  return true;
+}
+
+const bool ResourceTest::testResource(memory_management_area_t * Heap)
+{
+  fma32::HeapResource Resource(Heap);
+  fma32::HeapResource SameHeap(Heap);
+  fma32::HeapResource DefaultHeap;
+
+  if(!Resource.is_equal(SameHeap) || Resource.is_equal(DefaultHeap) || Resource.is_equal(*std::pmr::new_delete_resource()))
+  {
+    GetError() << "Memory resources equal without the same heap";
+    return false;
+  }
+
+  {
+    std::pmr::vector<unsigned long> Vector(&Resource);
+    std::pmr::unordered_map<unsigned long, std::pmr::string> Map(&Resource);
+    for(unsigned long Counter = 0; Counter < RESOURCE_COUNT; Counter++)
+    {
+      Vector.push_back(Counter);
+      Map.emplace(Counter, std::pmr::string(64, 'a' + Counter % 26));
+    }
+    if(!memory_heap_owns(Heap, Vector.data()) || !InHeap(Heap, Map.begin(), Map.end()) ||
+       !memory_heap_owns(Heap, (void *)Map.begin()->second.data()))
+    {
+      GetError() << "Container memory outside of the heap";
+      return false;
+    }
+
+    // Aligned allocation, the size and the alignment are given back
+    void * Aligned = Resource.allocate(1000, 256);
+    if((Aligned == nullptr) || ((unsigned long)Aligned & 255) || !memory_heap_owns(Heap, Aligned))
+    {
+      GetError() << "Aligned allocation " << Aligned << " of the memory resource";
+      return false;
+    }
+    Resource.deallocate(Aligned, 1000, 256);
+
+    // An allocation bigger than the heap throws
+    bool Thrown = false;
+    try
+    {
+      Resource.deallocate(Resource.allocate(2 * RESOURCE_HEAP_SIZE), 2 * RESOURCE_HEAP_SIZE);
+    }
+    catch(const std::bad_alloc &)
+    {
+      Thrown = true;
+    }
+    if(!Thrown)
+    {
+      GetError() << "Failed allocation of the memory resource does not throw";
+      return false;
+    }
+  }
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool ResourceTest::testAllocator(memory_management_area_t * Heap)
+{
+  fma32::Allocator<unsigned long> Allocator(Heap);
+  fma32::Allocator<char> Rebound(Allocator);
+
+  if((Allocator != Rebound) || (Allocator == fma32::Allocator<unsigned long>()))
+  {
+    GetError() << "Allocators equal without the same heap";
+    return false;
+  }
+
+  {
+    std::vector<unsigned long, fma32::Allocator<unsigned long> > Vector(Allocator);
+    std::map<unsigned long, unsigned long, std::less<unsigned long>, fma32::Allocator<std::pair<const unsigned long, unsigned long> > > Map(Allocator);
+    std::vector<AlignedItem, fma32::Allocator<AlignedItem> > Aligned(Allocator);
+    for(unsigned long Counter = 0; Counter < RESOURCE_COUNT; Counter++)
+    {
+      Vector.push_back(Counter);
+      Map[Counter] = Counter;
+      if(Counter < RESOURCE_COUNT / 100)
+        Aligned.push_back(AlignedItem());
+    }
+    if(!memory_heap_owns(Heap, Vector.data()) || !InHeap(Heap, Map.begin(), Map.end()) ||
+       !memory_heap_owns(Heap, Aligned.data()) || ((unsigned long)Aligned.data() & (alignof(AlignedItem) - 1)))
+    {
+      GetError() << "Container memory outside of the heap or misaligned";
+      return false;
+    }
+
+    // The containers move with their heap
+    std::vector<unsigned long, fma32::Allocator<unsigned long> > Moved(std::move(Vector));
+    if((Moved.get_allocator() != Allocator) || !memory_heap_owns(Heap, Moved.data()))
+    {
+      GetError() << "Moved container outside of the heap";
+      return false;
+    }
+  }
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool ResourceTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[RESOURCE_HEAP_SIZE];
+
+  m_manager.HeapInit(address, RESOURCE_HEAP_SIZE);
+  bool TestPass = testResource(m_manager.GetHeap()) && testAllocator(m_manager.GetHeap());
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,22 @@
+#ifndef RESOURCETEST_H
+#define RESOURCETEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class ResourceTest : public TestBase
+{
+  private:
+    const bool testResource(memory_management_area_t * Heap);
+    const bool testAllocator(memory_management_area_t * Heap);
+  public:
+    ResourceTest(const std::string testName) : TestBase(testName){}
+    ~ResourceTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // RESOURCETEST_H
@@ -0,0 +1,63 @@
+#include "SharedHeapTest.h"
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+#define SHARED_HEAP_SIZE      (1024 * 1024)
+#define SHARED_HEAP_ITERATION 100000
+#define SHARED_HEAP_MAX_ALLOC (1024 + 1)
+
+void SharedHeapTest::Worker(unsigned Index)
+{
+  std::vector<void *> Blocks;
+  unsigned int Seed = Index;
+
+  for(unsigned long Counter = 0; Counter < SHARED_HEAP_ITERATION; Counter++)
+  {
+    void * ptr = memory_heap_alloc(m_heap, rand_r(&Seed) % SHARED_HEAP_MAX_ALLOC);
+    if(ptr != nullptr)
+      Blocks.push_back(ptr);
+
+    // Free randomly one of the blocks
+    if(!Blocks.empty() && (rand_r(&Seed) & 1))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand_r(&Seed) % Blocks.size());
+      memory_heap_free(m_heap, *iter);
+      Blocks.erase(iter);
+    }
+  }
+
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_heap_free(m_heap, *iter);
+}
+
+const bool SharedHeapTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[SHARED_HEAP_SIZE];
+  std::vector<std::thread> Threads;
+
+  m_manager.HeapInit(address, SHARED_HEAP_SIZE);
+  m_heap = m_manager.GetHeap();
+
+  for(unsigned Index = 0; Index < SHARED_HEAP_THREAD_COUNT; Index++)
+    Threads.push_back(std::thread(&SharedHeapTest::Worker, this, Index));
+  for(std::vector<std::thread>::iterator iter = Threads.begin(); iter != Threads.end(); iter++)
+    iter->join();
+
+  memory_lock_stats_t Stats;
+  memory_heap_get_lock_stats(m_heap, &Stats);
+  std::cout << "Lock acquire : " << Stats.acquire_count << "    contended : " << Stats.contended_count
+            << "    spin : " << Stats.spin_count << "    wait (ns) : " << Stats.wait_ns << std::endl;
+
+  // Check the memory integrity
+  bool TestPass = m_manager.CheckInitalMemory();
+  if(!TestPass)
+    GetError() << m_manager.GetError().str();
+
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,24 @@
+#ifndef SHAREDHEAPTEST_H
+#define SHAREDHEAPTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+#define SHARED_HEAP_THREAD_COUNT 4
+
+class SharedHeapTest : public TestBase
+{
+  private:
+    void Worker(unsigned Index);
+  public:
+    SharedHeapTest(const std::string testName) : TestBase(testName){}
+    ~SharedHeapTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+    memory_management_area_t * m_heap;
+};
+
+#endif // SHAREDHEAPTEST_H
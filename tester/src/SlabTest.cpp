@@ -0,0 +1,154 @@
+#include "SlabTest.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "memory_slab.h"
+
+#define SLAB_HEAP_SIZE      (1024 * 1024)
+#define SLAB_ITERATION      200000
+#define SLAB_FOOTPRINT      8000
+
+struct ObjectInformation {
+  unsigned long Size;
+  unsigned char Pattern;
+};
+
+typedef std::vector<std::pair<unsigned char *, ObjectInformation> > ObjectList;
+
+const bool SlabTest::test(void *address, unsigned long length)
+{
+  ObjectList Objects;
+  memory_slab_allocator_t allocator;
+  memory_management_area_t * heap;
+
+  m_manager.HeapInit(address, length);
+  heap = m_manager.GetHeap();
+  memory_slab_init(&allocator, heap);
+
+  // The objects take less memory in the slabs than in heap chunks, the
+  // footprint is the end of the last slab or chunk from the heap start
+  // (the deferred blocks are merged between the measures)
+  const unsigned long FootprintSize[] = {8, 32, 64};
+  for(unsigned i = 0; i < sizeof(FootprintSize) / sizeof(FootprintSize[0]); i++)
+  {
+    std::vector<void *> Kept;
+    unsigned long SlabEnd = 0;
+    unsigned long HeapEnd = 0;
+
+    for(unsigned long Counter = 0; Counter < SLAB_FOOTPRINT; Counter++)
+    {
+      void * ptr = memory_slab_alloc(&allocator, FootprintSize[i]);
+      if(ptr == nullptr)
+      {
+        GetError() << "Object " << Counter << " of " << FootprintSize[i] << " bytes not allocated";
+        return false;
+      }
+      if((unsigned long)MEMORY_SLAB_OF(ptr) + MEMORY_SLAB_SIZE > SlabEnd)
+        SlabEnd = (unsigned long)MEMORY_SLAB_OF(ptr) + MEMORY_SLAB_SIZE;
+      Kept.push_back(ptr);
+    }
+    for(std::vector<void *>::iterator iter = Kept.begin(); iter != Kept.end(); iter++)
+      memory_slab_free(*iter);
+    memory_slab_trim(&allocator);
+    memory_heap_coalesce(heap);
+    Kept.clear();
+
+    for(unsigned long Counter = 0; Counter < SLAB_FOOTPRINT; Counter++)
+    {
+      void * ptr = memory_heap_alloc(heap, FootprintSize[i]);
+      if(ptr == nullptr)
+      {
+        GetError() << "Chunk " << Counter << " of " << FootprintSize[i] << " bytes not allocated";
+        return false;
+      }
+      if((unsigned long)ptr + memory_usable_size(ptr) > HeapEnd)
+        HeapEnd = (unsigned long)ptr + memory_usable_size(ptr);
+      Kept.push_back(ptr);
+    }
+    for(std::vector<void *>::iterator iter = Kept.begin(); iter != Kept.end(); iter++)
+      memory_heap_free(heap, *iter);
+    memory_heap_coalesce(heap);
+
+    if(SlabEnd - (unsigned long)heap >= HeapEnd - (unsigned long)heap)
+    {
+      GetError() << SLAB_FOOTPRINT << " objects of " << FootprintSize[i] << " bytes take " << SlabEnd - (unsigned long)heap
+                 << " bytes in the slabs and " << HeapEnd - (unsigned long)heap << " bytes in the heap";
+      return false;
+    }
+  }
+
+  // An object freed twice is given only once by the next allocations
+  void * First = memory_slab_alloc(&allocator, 32);
+  void * Second = memory_slab_alloc(&allocator, 32);
+  memory_slab_free(First);
+  memory_slab_free(First);
+  void * Again = memory_slab_alloc(&allocator, 32);
+  void * Other = memory_slab_alloc(&allocator, 32);
+  if((Again != First) || (Other == First) || (MEMORY_SLAB_OF(First)->free_count != MEMORY_SLAB_OF(First)->object_count - 3))
+  {
+    GetError() << "Object " << First << " freed twice given twice";
+    return false;
+  }
+  memory_slab_free(Again);
+  memory_slab_free(Other);
+  memory_slab_free(Second);
+
+  for(unsigned long Counter = 0; Counter < SLAB_ITERATION; Counter++)
+  {
+    unsigned long Size = rand() % (MEMORY_SLAB_MAX_SIZE + 1);
+    unsigned char * ptr = (unsigned char *)memory_slab_alloc(&allocator, Size);
+    if(ptr != nullptr)
+    {
+      // The slab is found from the object address
+      memory_slab_t * slab = MEMORY_SLAB_OF(ptr);
+      if((slab->magic != MEMORY_SLAB_MAGIC) || (slab->object_size < Size))
+      {
+        GetError() << "Object " << (void *)ptr << " of size " << Size << " not in a valid slab";
+        return false;
+      }
+      ObjectInformation Info = {Size, (unsigned char)Counter};
+      memset(ptr, Info.Pattern, Size);
+      Objects.push_back(std::make_pair(ptr, Info));
+    }
+
+    if(!Objects.empty() && (rand() % 3 == 0))
+    {
+      ObjectList::iterator iter = Objects.begin() + (rand() % Objects.size());
+      // The object content must not be overwritten by the others objects
+      for(unsigned long i = 0; i < iter->second.Size; i++)
+      {
+        if(iter->first[i] != iter->second.Pattern)
+        {
+          GetError() << "Object " << (void *)iter->first << " overwritten";
+          return false;
+        }
+      }
+      memory_slab_free(iter->first);
+      Objects.erase(iter);
+    }
+  }
+
+  for(ObjectList::iterator iter = Objects.begin(); iter != Objects.end(); iter++)
+    memory_slab_free(iter->first);
+  memory_slab_trim(&allocator);
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool SlabTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[SLAB_HEAP_SIZE];
+
+  bool TestPass = test(address, SLAB_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,21 @@
+#ifndef SLABTEST_H
+#define SLABTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class SlabTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    SlabTest(const std::string testName) : TestBase(testName){}
+    ~SlabTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // SLABTEST_H
@@ -0,0 +1,172 @@
+#include "StatsTest.h"
+#include <cstdlib>
+#include <vector>
+
+#define STATS_HEAP_SIZE     (1024 * 1024)
+#define STATS_ITERATION     20000
+#define STATS_MAX_ALLOC     (4096 + 1)
+#define STATS_CHECK_PERIOD  1000
+
+extern "C" void block_get_levels(unsigned long size, memory_level_t *level);
+
+// Compare the statistics with the counters of the test and with a walk of the blocks
+const bool StatsTest::checkStats(unsigned long AllocCount, unsigned long FreeCount, unsigned long UsedSize)
+{
+  memory_stats_t Stats;
+  std::vector<unsigned long> FreeBlocks;
+  unsigned long FreeSize = 0;
+  unsigned long BlockUsed = 0;
+
+  memory_get_stats(&Stats);
+  if((Stats.alloc_count != AllocCount) || (Stats.free_count != FreeCount) || (Stats.used_size != UsedSize))
+  {
+    GetError() << "Statistics " << Stats.alloc_count << " allocs " << Stats.free_count << " frees " << Stats.used_size
+               << " bytes used instead of " << AllocCount << " " << FreeCount << " " << UsedSize;
+    return false;
+  }
+  if(Stats.peak_size < Stats.used_size)
+  {
+    GetError() << "Statistics peak " << Stats.peak_size << " under the used size " << Stats.used_size;
+    return false;
+  }
+
+  // Walk the blocks of the heap
+  FreeBlocks.resize(Stats.fl_count * MEMORY_SL_COUNT);
+  memory_block_t * Block = m_manager.GetFirstBlock();
+  while(1)
+  {
+    if(BLOCK_IS_FREE(Block))
+    {
+      memory_level_t Level;
+      block_get_levels(BLOCK_GET_MASKED_SIZE(Block), &Level);
+#if MEMORY_DEFER
+      // A parked block is free but out of the free lists
+      if(Block->prev != BLOCK_PARKED_LINK)
+#endif /* MEMORY_DEFER */
+      FreeBlocks[Level.fl * MEMORY_SL_COUNT + Level.sl]++;
+      FreeSize += BLOCK_GET_MASKED_SIZE(Block);
+    }
+    else
+    {
+      BlockUsed += BLOCK_GET_MASKED_SIZE(Block);
+    }
+    if(BLOCK_IS_LAST(Block))
+      break;
+    Block = (memory_block_t *)((unsigned long)Block + BLOCK_GET_MASKED_SIZE(Block) + BLOCK_HEADER_SIZE_USED);
+  }
+
+  if((Stats.free_size != FreeSize) || (Stats.used_size != BlockUsed))
+  {
+    GetError() << "Statistics " << Stats.free_size << " bytes free " << Stats.used_size << " bytes used, blocks have "
+               << FreeSize << " " << BlockUsed;
+    return false;
+  }
+  for(unsigned long Index = 0; Index < FreeBlocks.size(); Index++)
+  {
+    if(Stats.free_blocks[Index] != FreeBlocks[Index])
+    {
+      GetError() << "Histogram level (" << Index / MEMORY_SL_COUNT << ", " << Index % MEMORY_SL_COUNT << ") has "
+                 << Stats.free_blocks[Index] << " free blocks instead of " << FreeBlocks[Index];
+      return false;
+    }
+  }
+  return true;
+}
+
+const bool StatsTest::test(void *address, unsigned long length)
+{
+  std::vector<void *> Blocks;
+  unsigned long AllocCount = 0;
+  unsigned long FreeCount = 0;
+  unsigned long UsedSize = 0;
+  memory_stats_t Stats;
+
+  m_manager.MemoryInit(address, length);
+
+  for(unsigned long Counter = 0; Counter < STATS_ITERATION; Counter++)
+  {
+    void * Ptr;
+    switch(rand() % 4)
+    {
+      case 0:
+        // Aligned allocation
+        Ptr = memory_memalign(64, rand() % STATS_MAX_ALLOC);
+        break;
+      case 1:
+        // Grow or shrink in place
+        if(!Blocks.empty())
+        {
+          void * Resized = Blocks[rand() % Blocks.size()];
+          unsigned long OldSize = memory_usable_size(Resized);
+          if(memory_try_expand(Resized, rand() % STATS_MAX_ALLOC))
+            UsedSize += memory_usable_size(Resized) - OldSize;
+        }
+        Ptr = nullptr;
+        break;
+      default:
+        Ptr = memory_alloc(rand() % STATS_MAX_ALLOC);
+        break;
+    }
+    if(Ptr != nullptr)
+    {
+      AllocCount++;
+      UsedSize += memory_usable_size(Ptr);
+      Blocks.push_back(Ptr);
+    }
+
+    if(!Blocks.empty() && (rand() & 1))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      FreeCount++;
+      UsedSize -= memory_usable_size(*iter);
+      memory_free(*iter);
+      Blocks.erase(iter);
+    }
+
+    if(((Counter % STATS_CHECK_PERIOD) == 0) && !checkStats(AllocCount, FreeCount, UsedSize))
+      return false;
+  }
+
+  // A failed allocation is counted
+  memory_get_stats(&Stats);
+  unsigned long FailedCount = Stats.failed_count;
+  if(memory_alloc(length) != nullptr)
+  {
+    GetError() << "Allocation bigger than the heap";
+    return false;
+  }
+  memory_get_stats(&Stats);
+  if(Stats.failed_count != FailedCount + 1)
+  {
+    GetError() << "Failed allocation not counted";
+    return false;
+  }
+
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+  {
+    FreeCount++;
+    memory_free(*iter);
+  }
+  if(!checkStats(AllocCount, FreeCount, 0))
+    return false;
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool StatsTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[STATS_HEAP_SIZE];
+
+  bool TestPass = test(address, STATS_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
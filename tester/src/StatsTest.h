@@ -0,0 +1,22 @@
+#ifndef STATSTEST_H
+#define STATSTEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class StatsTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+    const bool checkStats(unsigned long AllocCount, unsigned long FreeCount, unsigned long UsedSize);
+  public:
+    StatsTest(const std::string testName) : TestBase(testName){}
+    ~StatsTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // STATSTEST_H
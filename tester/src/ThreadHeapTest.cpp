@@ -0,0 +1,123 @@
+#include "ThreadHeapTest.h"
+#include <thread>
+#include <cstdlib>
+#include "memory_thread.h"
+
+#define THREAD_HEAP_SIZE      (256 * 1024)
+#define THREAD_HEAP_ITERATION 20000
+#define THREAD_HEAP_MAX_ALLOC (1024 + 1)
+
+void ThreadHeapTest::Wait(void)
+{
+  // Barrier between all the worker threads
+  std::unique_lock<std::mutex> lock(m_mutex);
+  unsigned generation = m_generation;
+  if(++m_waiting == THREAD_HEAP_COUNT)
+  {
+    m_waiting = 0;
+    m_generation++;
+    m_cond.notify_all();
+  }
+  else
+  {
+    m_cond.wait(lock, [this, generation]{ return generation != m_generation; });
+  }
+}
+
+void ThreadHeapTest::Worker(unsigned Index, void *address, unsigned long length)
+{
+  std::vector<void *> Own;
+  std::vector<void *> Received;
+  unsigned Next = (Index + 1) % THREAD_HEAP_COUNT;
+  unsigned int Seed = Index;
+
+  m_pass[Index] = memory_thread_init(address, length);
+  if(m_pass[Index])
+    m_managers[Index].HeapAttach(memory_thread_get_heap());
+  Wait();
+
+  for(unsigned long Counter = 0; m_pass[Index] && (Counter < THREAD_HEAP_ITERATION); Counter++)
+  {
+    void * ptr = memory_thread_alloc(rand_r(&Seed) % THREAD_HEAP_MAX_ALLOC);
+    if(ptr != nullptr)
+    {
+      // Send one block out of two to the next thread
+      if(Counter & 1)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_mailbox[Next].push_back(ptr);
+      }
+      else
+        Own.push_back(ptr);
+    }
+
+    // Free the blocks received from the previous thread
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      Received.swap(m_mailbox[Index]);
+    }
+    for(std::vector<void *>::iterator iter = Received.begin(); iter != Received.end(); iter++)
+      memory_thread_free(*iter);
+    Received.clear();
+
+    // Free some own blocks
+    if(!Own.empty() && (rand_r(&Seed) & 1))
+    {
+      memory_thread_free(Own.back());
+      Own.pop_back();
+    }
+  }
+  Wait();
+
+  // Free all the remaining blocks
+  for(std::vector<void *>::iterator iter = Own.begin(); iter != Own.end(); iter++)
+    memory_thread_free(*iter);
+  for(std::vector<void *>::iterator iter = m_mailbox[Index].begin(); iter != m_mailbox[Index].end(); iter++)
+    memory_thread_free(*iter);
+  Wait();
+
+  // All the blocks freed by the others threads must be back in the heap
+  memory_thread_collect();
+  if(m_pass[Index])
+    m_pass[Index] = m_managers[Index].CheckInitalMemory();
+  memory_thread_release();
+}
+
+const bool ThreadHeapTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  // A refused heap takes no slot, the workers still get theirs
+  unsigned long Small[(sizeof(memory_thread_heap_t) + 2 * sizeof(unsigned long)) / sizeof(unsigned long)];
+  for(unsigned long Counter = 0; Counter < 2 * MEMORY_THREAD_HEAP_MAX; Counter++)
+  {
+    if(memory_thread_init(Small, sizeof(Small)))
+    {
+      GetError() << "Thread heap of " << sizeof(Small) << " bytes accepted";
+      return false;
+    }
+  }
+
+  char * address = new char[THREAD_HEAP_COUNT * THREAD_HEAP_SIZE];
+  std::vector<std::thread> Threads;
+
+  for(unsigned Index = 0; Index < THREAD_HEAP_COUNT; Index++)
+    Threads.push_back(std::thread(&ThreadHeapTest::Worker, this, Index, address + Index * THREAD_HEAP_SIZE, THREAD_HEAP_SIZE));
+  for(std::vector<std::thread>::iterator iter = Threads.begin(); iter != Threads.end(); iter++)
+    iter->join();
+
+  bool TestPass = true;
+  for(unsigned Index = 0; Index < THREAD_HEAP_COUNT; Index++)
+  {
+    if(!m_pass[Index])
+    {
+      GetError() << "Thread heap " << Index << " : " << m_managers[Index].GetError().str();
+      TestPass = false;
+      break;
+    }
+  }
+  delete [] address;
+  return TestPass;
+}
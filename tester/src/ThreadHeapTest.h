@@ -0,0 +1,35 @@
+#ifndef THREADHEAPTEST_H
+#define THREADHEAPTEST_H
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "Blocks.h"
+#include "test.h"
+
+#define THREAD_HEAP_COUNT 4
+
+class ThreadHeapTest : public TestBase
+{
+  private:
+    void Worker(unsigned Index, void *address, unsigned long length);
+    void Wait(void);
+  public:
+    ThreadHeapTest(const std::string testName) : TestBase(testName), m_waiting(0), m_generation(0){}
+    ~ThreadHeapTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_managers[THREAD_HEAP_COUNT];
+    bool m_pass[THREAD_HEAP_COUNT];
+
+    // Pointers sent to each thread to be freed
+    std::vector<void *> m_mailbox[THREAD_HEAP_COUNT];
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    unsigned m_waiting;
+    unsigned m_generation;
+};
+
+#endif // THREADHEAPTEST_H
@@ -0,0 +1,131 @@
+#include "TraceTest.h"
+#include <cstdio>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#define TRACE_HEAP_SIZE     (64 * 1024)
+#define TRACE_ITERATION     10000
+#define TRACE_MAX_ALLOC     (1024 + 1)
+#define TRACE_FILE          "TraceTest.trace"
+#define TRACE_RESTART       200
+
+const bool TraceTest::test(void *address, unsigned long length)
+{
+  std::vector<void *> Blocks;
+  std::vector<memory_trace_record_t> Expected;
+  memory_trace_record_t Record;
+
+  m_manager.MemoryInit(address, length);
+
+  // Nothing is recorded before the start
+  memory_free(memory_alloc(64));
+
+  if(memory_trace_start(TRACE_FILE) == 0)
+  {
+    GetError() << "Trace file " << TRACE_FILE << " can not be created";
+    return false;
+  }
+
+  for(unsigned long Counter = 0; Counter < TRACE_ITERATION; Counter++)
+  {
+    // Some allocations are too big for the heap and fail
+    unsigned long Size = (Counter % 97 == 0) ? 2 * length : rand() % TRACE_MAX_ALLOC;
+    void * Ptr = memory_alloc(Size);
+    Record.op = MEMORY_TRACE_ALLOC;
+    Record.size = Size;
+    Record.handle = (Ptr != nullptr) ? ((char *)Ptr - (char *)m_manager.GetHeap()) / sizeof(unsigned long) : MEMORY_TRACE_NO_HANDLE;
+    Expected.push_back(Record);
+    if(Ptr != nullptr)
+      Blocks.push_back(Ptr);
+
+    if(!Blocks.empty() && (rand() & 1))
+    {
+      std::vector<void *>::iterator iter = Blocks.begin() + (rand() % Blocks.size());
+      Record.op = MEMORY_TRACE_FREE;
+      Record.size = 0;
+      Record.handle = ((char *)*iter - (char *)m_manager.GetHeap()) / sizeof(unsigned long);
+      Expected.push_back(Record);
+      memory_free(*iter);
+      Blocks.erase(iter);
+    }
+  }
+  memory_trace_stop();
+
+  // Nothing is recorded after the stop
+  for(std::vector<void *>::iterator iter = Blocks.begin(); iter != Blocks.end(); iter++)
+    memory_free(*iter);
+
+  FILE * File = fopen(TRACE_FILE, "rb");
+  if(File == nullptr)
+  {
+    GetError() << "Trace file " << TRACE_FILE << " not found";
+    return false;
+  }
+  std::vector<memory_trace_record_t> Records(Expected.size() + 1);
+  unsigned long Count = fread(&Records[0], sizeof(memory_trace_record_t), Records.size(), File);
+  fclose(File);
+  remove(TRACE_FILE);
+
+  if(Count != Expected.size())
+  {
+    GetError() << "Trace has " << Count << " records for " << Expected.size() << " calls";
+    return false;
+  }
+  for(unsigned long Index = 0; Index < Count; Index++)
+  {
+    if((Records[Index].op != Expected[Index].op) || (Records[Index].handle != Expected[Index].handle) ||
+       (Records[Index].size != Expected[Index].size))
+    {
+      GetError() << "Trace record " << Index << " is op " << Records[Index].op << " handle " << Records[Index].handle
+                 << " size " << Records[Index].size << " instead of op " << Expected[Index].op << " handle "
+                 << Expected[Index].handle << " size " << Expected[Index].size;
+      return false;
+    }
+  }
+
+#if MEMORY_LOCK != MEMORY_LOCK_NONE
+  // The trace is started and stopped while another thread calls the heap
+  std::atomic<bool> Running(true);
+  std::thread Worker([&Running]()
+  {
+    while(Running.load())
+      memory_free(memory_alloc(64));
+  });
+  bool Started = true;
+  for(unsigned long Counter = 0; Started && (Counter < TRACE_RESTART); Counter++)
+  {
+    Started = (memory_trace_start(TRACE_FILE) != 0);
+    memory_trace_stop();
+  }
+  Running.store(false);
+  Worker.join();
+  remove(TRACE_FILE);
+  if(!Started)
+  {
+    GetError() << "Trace file " << TRACE_FILE << " can not be created again";
+    return false;
+  }
+#endif /* MEMORY_LOCK */
+
+  if(m_manager.CheckInitalMemory() == false)
+  {
+    GetError() << m_manager.GetError().str();
+    return false;
+  }
+  return true;
+}
+
+const bool TraceTest::Execute(void)
+{
+  std::cout << "*******************************" << std::endl;
+  std::cout << "* " << this->GetName() << std::endl;
+  std::cout << "*******************************" << std::endl;
+
+  char * address = new char[TRACE_HEAP_SIZE];
+
+  bool TestPass = test(address, TRACE_HEAP_SIZE);
+  delete [] address;
+  return TestPass;
+}
@@ -0,0 +1,21 @@
+#ifndef TRACETEST_H
+#define TRACETEST_H
+
+#include "Blocks.h"
+#include "test.h"
+
+class TraceTest : public TestBase
+{
+  private:
+    const bool test(void *address, unsigned long length);
+  public:
+    TraceTest(const std::string testName) : TestBase(testName){}
+    ~TraceTest(){}
+
+    const bool Execute(void);
+
+  private:
+    MemoryBlockManager m_manager;
+};
+
+#endif // TRACETEST_H